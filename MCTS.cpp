@@ -11,9 +11,21 @@
 #include <vector>
 #include <stdexcept>
 #include <algorithm>
+#include <limits>
 #include <unordered_map>
 #include <cstdlib>
 #include <sstream>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#endif
+#ifndef _WIN32
+#include <unistd.h>
+#include <cerrno>
+#endif
 #ifdef _BOTZONE_ONLINE
 #include "jsoncpp/json.h"
 #else
@@ -30,7 +42,166 @@ using std::queue;
 using std::vector;
 using std::pair;
 
-std::ofstream debug("debug.txt", std::ofstream::out);
+// Trace points (TRACE) compile to nothing in the Botzone build. Otherwise they
+// append fixed-size binary records to a ring that TRACE_DRAIN formats into
+// debug.txt after the decision is made, off the search hot path.
+// Define TANK2_NO_TRACE to compile them out of a local build as well.
+//
+// TRACE_BEGIN/TRACE_END/TRACE_SPAN mark spans of the turn (input parsing,
+// history replay, root construction, simulation batches, output). With the
+// environment variable TANK2_CHROME_TRACE set to a path, TRACE_DRAIN also
+// writes the records there in Chrome trace event format (chrome://tracing,
+// Perfetto), spans as slices and the other points as instant events.
+#if !defined(_BOTZONE_ONLINE) && !defined(TANK2_NO_TRACE)
+#define TANK2_TRACE
+#endif
+
+#ifdef TANK2_TRACE
+namespace Trace
+{
+    enum Event { DpDistance, DpResult, RootAction, SearchDone, EvalCacheStats, Candidate, SpanBegin, SpanEnd };
+    const char *eventNames[] = { "DpDistance", "DpResult", "RootAction", "SearchDone", "EvalCacheStats",
+        "Candidate", "SpanBegin", "SpanEnd" };
+    enum Span { ParseInput, ReplayHistory, BuildRoot, SimulationBatch, WriteOutput };
+    const char *spanNames[] = { "ParseInput", "ReplayHistory", "BuildRoot", "SimulationBatch", "WriteOutput" };
+
+    struct Record
+    {
+        long long ns;
+        int event, a, b, c;
+        double x, y;
+    };
+
+    // spans get their own ring so the frequent points cannot evict them
+    const unsigned ringSize = 1 << 16, spanRingSize = 1 << 12;
+    Record ring[ringSize], spanRing[spanRingSize];
+    unsigned head = 0, spanHead = 0;
+
+    inline long long Now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    inline void Emit(Event event, int a, int b, int c, double x, double y)
+    {
+        Record &r = event == SpanBegin || event == SpanEnd
+            ? spanRing[spanHead++ & (spanRingSize - 1)] : ring[head++ & (ringSize - 1)];
+        r.ns = Now();
+        r.event = event;
+        r.a = a, r.b = b, r.c = c;
+        r.x = x, r.y = y;
+    }
+
+    struct Scope
+    {
+        Span span;
+        explicit Scope(Span span) : span(span) { Emit(SpanBegin, span, 0, 0, 0, 0); }
+        ~Scope() { Emit(SpanEnd, span, 0, 0, 0, 0); }
+    };
+
+    // the retained records of both rings in time order; dropped counts the
+    // points that were overwritten
+    vector<Record> Collect(unsigned &dropped)
+    {
+        unsigned first = head > ringSize ? head - ringSize : 0;
+        unsigned spanFirst = spanHead > spanRingSize ? spanHead - spanRingSize : 0;
+        vector<Record> points, spans, all;
+        for (unsigned i = first; i < head; i++)
+            points.push_back(ring[i & (ringSize - 1)]);
+        for (unsigned i = spanFirst; i < spanHead; i++)
+            spans.push_back(spanRing[i & (spanRingSize - 1)]);
+        all.resize(points.size() + spans.size());
+        std::merge(points.begin(), points.end(), spans.begin(), spans.end(), all.begin(),
+            [](const Record &a, const Record &b) { return a.ns < b.ns; });
+        dropped = first + spanFirst;
+        return all;
+    }
+
+    void Format(std::ostream &out, const Record &r)
+    {
+        switch (r.event)
+        {
+        case DpDistance:
+            out << "dp side " << r.a << ": D1 = " << r.x << " D2 = " << r.y;
+            break;
+        case DpResult:
+            out << "dp side " << r.a << ": protectBricks = " << r.x << " return value is " << r.y;
+            break;
+        case RootAction:
+            out << r.a << ":  (" << r.b << ", " << r.c << ")  " << r.x << '/' << r.y << '=' << r.x / r.y;
+            break;
+        case SearchDone:
+            out << r.a << ' ' << r.b << ' ' << r.c << ' ' << r.x << '/' << r.y << '=' << r.x / r.y;
+            break;
+        case EvalCacheStats:
+            out << "evalCache: " << r.x << '/' << r.y << " hit rate " << (r.y ? r.x / r.y : 0)
+                << " (" << r.a << " MB)";
+            break;
+        case Candidate:
+            out << " (" << r.a << ", " << r.b << ") : " << r.x << '/' << r.y << " : " << r.x / r.y;
+            break;
+        case SpanBegin:
+        case SpanEnd:
+            out << (r.event == SpanBegin ? "begin " : "end ") << spanNames[r.a];
+            break;
+        }
+    }
+
+    // Chrome trace event format; timestamps in microseconds from the first record
+    void DrainChrome(const char *path, const vector<Record> &records)
+    {
+        std::ofstream out(path);
+        long long start = records.empty() ? 0 : records.front().ns;
+        out << "{\"traceEvents\":[";
+        for (size_t i = 0; i < records.size(); i++)
+        {
+            const Record &r = records[i];
+            out << (i ? ",\n" : "\n") << "{\"pid\":1,\"tid\":1,\"ts\":" << (r.ns - start) / 1000.;
+            if (r.event == SpanBegin || r.event == SpanEnd)
+                out << ",\"ph\":\"" << (r.event == SpanBegin ? 'B' : 'E') << "\",\"name\":\"" << spanNames[r.a] << '"';
+            else
+                out << ",\"ph\":\"i\",\"s\":\"t\",\"name\":\"" << eventNames[r.event] << "\",\"args\":{\"a\":" << r.a
+                    << ",\"b\":" << r.b << ",\"c\":" << r.c << ",\"x\":" << r.x << ",\"y\":" << r.y << '}';
+            out << '}';
+        }
+        out << "\n]}\n";
+    }
+
+    // the first drain of a process truncates the file, later ones append
+    void Drain(const char *path)
+    {
+        unsigned dropped;
+        vector<Record> records = Collect(dropped);
+        if (const char *chrome = getenv("TANK2_CHROME_TRACE"))
+            DrainChrome(chrome, records);
+        static bool truncated = false;
+        std::ofstream out(path, truncated ? std::ofstream::app : std::ofstream::out);
+        truncated = true;
+        if (dropped)
+            out << "(" << dropped << " older trace records dropped)\n";
+        long long start = records.empty() ? 0 : records.front().ns;
+        for (const Record &r : records)
+        {
+            out << '+' << (r.ns - start) / 1000 << "us ";
+            Format(out, r);
+            out << '\n';
+        }
+        head = spanHead = 0;
+    }
+}
+#define TRACE(event, a, b, c, x, y) Trace::Emit(Trace::event, a, b, c, x, y)
+#define TRACE_BEGIN(span) Trace::Emit(Trace::SpanBegin, Trace::span, 0, 0, 0, 0)
+#define TRACE_END(span) Trace::Emit(Trace::SpanEnd, Trace::span, 0, 0, 0, 0)
+#define TRACE_SPAN(span) Trace::Scope traceScope##span(Trace::span)
+#define TRACE_DRAIN() Trace::Drain("debug.txt")
+#else
+#define TRACE(event, a, b, c, x, y) ((void)0)
+#define TRACE_BEGIN(span) ((void)0)
+#define TRACE_END(span) ((void)0)
+#define TRACE_SPAN(span) ((void)0)
+#define TRACE_DRAIN() ((void)0)
+#endif
 
 namespace TankGame
 {
@@ -151,6 +322,16 @@ namespace TankGame
         return -1;
     }
 
+    // 64 位整数混合（splitmix64 的收尾步骤），用于拼局面哈希
+    inline unsigned long long HashMix(unsigned long long h)
+    {
+        h ^= h >> 30;
+        h *= 0xBF58476D1CE4E5B9ULL;
+        h ^= h >> 27;
+        h *= 0x94D049BB133111EBULL;
+        return h ^ (h >> 31);
+    }
+
     // 物件消失的记录，用于回退
     struct DisappearLog
     {
@@ -172,6 +353,109 @@ namespace TankGame
         }
     };
 
+    // 钢墙和水在整局中不会变化，由它们推出的表在拿到地图时计算一次，
+    // 之后所有 TankField 拷贝（以及 Judger、模拟策略）只读共享同一份
+    struct StaticMap
+    {
+        int steelMask[3], waterMask[3];
+        unsigned long long fingerprint;
+
+        // 坦克可能站上去的格子（不是钢、水或基地）
+        bool passable[fieldHeight][fieldWidth];
+
+        // 从该格向 dir 方向射击，子弹在出界或碰到钢墙前经过的格子数
+        int rayLength[fieldHeight][fieldWidth][4];
+
+        // 从该格射击可以打到 side 方基地（不考虑砖块和坦克的遮挡）
+        bool seesBase[sideCount][fieldHeight][fieldWidth];
+
+        StaticMap(const int hasWater[3], const int hasSteel[3])
+        {
+            fingerprint = Fingerprint(hasWater, hasSteel);
+            for (int i = 0; i < 3; i++)
+            {
+                steelMask[i] = hasSteel[i];
+                waterMask[i] = hasWater[i];
+            }
+            bool steel[fieldHeight][fieldWidth];
+            for (int y = 0; y < fieldHeight; y++)
+                for (int x = 0; x < fieldWidth; x++)
+                {
+                    int mask = 1 << ((y % 3) * fieldWidth + x);
+                    steel[y][x] = !!(hasSteel[y / 3] & mask);
+                    passable[y][x] = !steel[y][x] && !(hasWater[y / 3] & mask);
+                }
+            for (int side = 0; side < sideCount; side++)
+                passable[baseY[side]][baseX[side]] = false;
+
+            for (int y = 0; y < fieldHeight; y++)
+                for (int x = 0; x < fieldWidth; x++)
+                    for (int dir = 0; dir < 4; dir++)
+                    {
+                        int len = 0, xx = x + dx[dir], yy = y + dy[dir];
+                        for (; CoordValid(xx, yy) && !steel[yy][xx]; xx += dx[dir], yy += dy[dir])
+                            len++;
+                        rayLength[y][x][dir] = len;
+                    }
+
+            memset(seesBase, 0, sizeof(seesBase));
+            for (int side = 0; side < sideCount; side++)
+                for (int dir = 0; dir < 4; dir++)
+                {
+                    int x = baseX[side], y = baseY[side];
+                    for (int i = rayLength[y][x][dir]; i > 0; i--)
+                    {
+                        x += dx[dir];
+                        y += dy[dir];
+                        seesBase[side][y][x] = true;
+                    }
+                }
+        }
+
+        // 同一张图只预处理一次；返回的表在程序结束前一直有效
+        static const StaticMap* Get(const int hasWater[3], const int hasSteel[3])
+        {
+            std::lock_guard<std::mutex> guard(_lock());
+            if (const StaticMap *m = _find(hasWater, hasSteel))
+                return m;
+            StaticMap *built = new StaticMap(hasWater, hasSteel);
+            _maps()[built->fingerprint].push_back(built);
+            return built;
+        }
+
+        static unsigned long long Fingerprint(const int hasWater[3], const int hasSteel[3])
+        {
+            unsigned long long h = 1469598103934665603ULL;
+            for (int i = 0; i < 3; i++)
+            {
+                h = (h ^ (unsigned)hasSteel[i]) * 1099511628211ULL;
+                h = (h ^ (unsigned)hasWater[i]) * 1099511628211ULL;
+            }
+            return h;
+        }
+
+    private:
+        static std::mutex &_lock()
+        {
+            static std::mutex lock;
+            return lock;
+        }
+        static std::unordered_map<unsigned long long, vector<StaticMap*> > &_maps()
+        {
+            static std::unordered_map<unsigned long long, vector<StaticMap*> > maps;
+            return maps;
+        }
+        // 调用前需持有 _lock()
+        static const StaticMap* _find(const int hasWater[3], const int hasSteel[3])
+        {
+            for (StaticMap *m : _maps()[Fingerprint(hasWater, hasSteel)])
+                if (!memcmp(m->steelMask, hasSteel, sizeof(m->steelMask)) &&
+                    !memcmp(m->waterMask, hasWater, sizeof(m->waterMask)))
+                    return m;
+            return nullptr;
+        }
+    };
+
 #ifdef _MSC_VER
 #pragma endregion
 
@@ -209,6 +493,9 @@ namespace TankGame
         // 用于回退的log
         stack<DisappearLog> logs;
 
+        // 本局地图的静态预处理结果
+        const StaticMap *terrain = nullptr;
+
         // 过往动作（previousActions[x] 表示所有人在第 x 回合的动作，第 0 回合的动作没有意义）
         Action previousActions[101][sideCount][tankPerSide] = { { { Stay, Stay },{ Stay, Stay } } };
 
@@ -268,7 +555,22 @@ namespace TankGame
         {
             if (!ActionIsValid())
                 return false;
+            _doAction<true>();
+            return true;
+        }
+
+        // Trusted replay of a turn the judge already accepted (the history in
+        // the request): no validation and no undo logs, so Revert cannot step
+        // back over it
+        void ReplayAction()
+        {
+            _doAction<false>();
+        }
 
+    private:
+        template <bool undoLog>
+        void _doAction()
+        {
             // 1 移动
             for (int side = 0; side < sideCount; side++)
                 for (int tank = 0; tank < tankPerSide; tank++)
@@ -283,25 +585,31 @@ namespace TankGame
                         FieldItem &items = gameField[y][x];
 
                         // 记录 Log
-                        DisappearLog log;
-                        log.x = x;
-                        log.y = y;
-                        log.item = tankItemTypes[side][tank];
-                        log.turn = currentTurn;
-                        logs.push(log);
+                        FieldItem item = tankItemTypes[side][tank];
+                        if (undoLog)
+                        {
+                            DisappearLog log;
+                            log.x = x;
+                            log.y = y;
+                            log.item = item;
+                            log.turn = currentTurn;
+                            logs.push(log);
+                        }
 
                         // 变更坐标
                         x += dx[act];
                         y += dy[act];
 
                         // 更换标记（注意格子可能有多个坦克）
-                        gameField[y][x] |= log.item;
-                        items &= ~log.item;
+                        gameField[y][x] |= item;
+                        items &= ~item;
                     }
                 }
 
             // 2 射♂击!
-            set<DisappearLog> itemsToBeDestroyed;
+            // at most 4 shots hitting one cell each; a cell hit twice is destroyed once
+            DisappearLog itemsToBeDestroyed[sideCount * tankPerSide * 8];
+            int destroyCount = 0;
             for (int side = 0; side < sideCount; side++)
                 for (int tank = 0; tank < tankPerSide; tank++)
                 {
@@ -345,7 +653,12 @@ namespace TankGame
                                         log.y = y;
                                         log.item = (FieldItem)mask;
                                         log.turn = currentTurn;
-                                        itemsToBeDestroyed.insert(log);
+                                        bool marked = false;
+                                        for (int i = 0; i < destroyCount && !marked; i++)
+                                            marked = itemsToBeDestroyed[i].x == x && itemsToBeDestroyed[i].y == y &&
+                                                itemsToBeDestroyed[i].item == mask;
+                                        if (!marked)
+                                            itemsToBeDestroyed[destroyCount++] = log;
                                     }
                                 break;
                             }
@@ -353,8 +666,9 @@ namespace TankGame
                     }
                 }
 
-            for (auto& log : itemsToBeDestroyed)
+            for (int i = 0; i < destroyCount; i++)
             {
+                DisappearLog &log = itemsToBeDestroyed[i];
                 switch (log.item)
                 {
                 case Base:
@@ -381,7 +695,8 @@ namespace TankGame
                     ;
                 }
                 gameField[log.y][log.x] &= ~log.item;
-                logs.push(log);
+                if (undoLog)
+                    logs.push(log);
             }
 
             for (int side = 0; side < sideCount; side++)
@@ -389,9 +704,10 @@ namespace TankGame
                     nextAction[side][tank] = Invalid;
 
             currentTurn++;
-            return true;
         }
 
+    public:
+
         // 回到上一回合
         bool Revert()
         {
@@ -458,7 +774,8 @@ namespace TankGame
            brick>water>steel
         */
         TankField() = default;
-        TankField(int hasBrick[3],int hasWater[3],int hasSteel[3], int mySide) : mySide(mySide)
+        TankField(int hasBrick[3],int hasWater[3],int hasSteel[3], int mySide)
+            : mySide(mySide), terrain(StaticMap::Get(hasWater, hasSteel))
         {
             for (int i = 0; i < 3; i++)
             {
@@ -485,7 +802,7 @@ namespace TankGame
             }
         }
         TankField(const TankField & ob)
-            :currentTurn(ob.currentTurn), logs(ob.logs),mySide(ob.mySide)
+            :currentTurn(ob.currentTurn), logs(ob.logs),mySide(ob.mySide), terrain(ob.terrain)
             {
                 memcpy(gameField, ob.gameField,sizeof(ob.gameField));
                 memcpy(tankAlive, ob.tankAlive, sizeof(ob.tankAlive));
@@ -499,6 +816,7 @@ namespace TankGame
             currentTurn = ob.currentTurn;
             logs = ob.logs;
             mySide = ob.mySide;
+            terrain = ob.terrain;
             memcpy(gameField, ob.gameField,sizeof(ob.gameField));
             memcpy(tankAlive, ob.tankAlive, sizeof(ob.tankAlive));
             memcpy(tankX, ob.tankX, sizeof(ob.tankX));
@@ -581,6 +899,26 @@ namespace TankGame
 #endif
         }
 
+        // 局面哈希：地图、砖块、坦克位置和基地，不含回合编号和过往动作
+        unsigned long long Hash() const
+        {
+            unsigned long long bricks[2] = {};
+            for (int y = 0; y < fieldHeight; y++)
+                for (int x = 0; x < fieldWidth; x++)
+                    if (gameField[y][x] & Brick)
+                    {
+                        int i = y * fieldWidth + x;
+                        bricks[i >> 6] |= 1ULL << (i & 63);
+                    }
+            unsigned long long h = HashMix((terrain ? terrain->fingerprint : 0) ^ bricks[0]);
+            h = HashMix(h ^ bricks[1]);
+            unsigned long long tanks = baseAlive[0] | baseAlive[1] << 1;
+            for (int side = 0; side < sideCount; side++)
+                for (int tank = 0; tank < tankPerSide; tank++)
+                    tanks = tanks << 8 | (tankAlive[side][tank] ? tankY[side][tank] * fieldWidth + tankX[side][tank] : 0xFF);
+            return HashMix(h ^ tanks);
+        }
+
         bool operator!= (const TankField& b) const
         {
 
@@ -616,6 +954,12 @@ namespace TankGame
 #endif
 
     TankField *field;
+    // time ReadInput spent replaying the game history into field
+    double replayMicroseconds = 0;
+
+    // ReadInput 在重放历史、建立 TankField 之前把 globaldata 交给它，
+    // 用来恢复跨回合、跨局保存的预处理表
+    void (*globalDataLoader)(const string &globalData) = nullptr;
 
 #ifdef _MSC_VER
 #pragma region 与平台交互部分
@@ -625,13 +969,8 @@ namespace TankGame
     namespace Internals
     {
         Json::Reader reader;
-#ifdef _BOTZONE_ONLINE
-        Json::FastWriter writer;
-#else
-        Json::StyledWriter writer;
-#endif
 
-        void _processRequestOrResponse(Json::Value& value, bool isOpponent)
+        void _processRequestOrResponse(const Json::Value& value, bool isOpponent)
         {
             if (value.isArray())
             {
@@ -644,7 +983,7 @@ namespace TankGame
                 {
                     for (int tank = 0; tank < tankPerSide; tank++)
                         field->nextAction[1 - field->mySide][tank] = (Action)value[tank].asInt();
-                    field->DoAction();
+                    field->ReplayAction();
                 }
             }
             else
@@ -660,20 +999,312 @@ namespace TankGame
             }
         }
 
+        // Parser for the usual Botzone input {"requests":[map, [a,b], ...],
+        // "responses":[[a,b], ...], "data":"...", "globaldata":"..."} that reads
+        // the line in place: no DOM, no heap work besides the data strings.
+        // Anything else (other shapes, escapes, floats) fails the parse and
+        // ReadInput falls back to jsoncpp; nothing is applied before success.
+        class RequestParser
+        {
+        public:
+            // the map plus one request per turn; longer histories would replay
+            // past TankField::previousActions[101], so they fail the parse
+            static const int maxHistory = 101;
+            int brick[3], water[3], steel[3], mySide;
+            int requestCount, responseCount;
+            int requests[maxHistory][tankPerSide], responses[maxHistory][tankPerSide];
+            const char *dataBegin, *dataEnd, *globalBegin, *globalEnd;
+
+            bool parse(const char *begin, const char *end)
+            {
+                p = begin, this->end = end;
+                requestCount = responseCount = 0;
+                dataBegin = dataEnd = globalBegin = globalEnd = nullptr;
+                bool haveMap = false;
+                if (!expect('{'))
+                    return false;
+                if (peek('}'))
+                    return false;
+                do
+                {
+                    const char *key, *keyEnd;
+                    if (!text(key, keyEnd) || !expect(':'))
+                        return false;
+                    if (is(key, keyEnd, "requests"))
+                    {
+                        if (!expect('[') || !mapObject() || (peek(',') && !pairs(requests, requestCount)) || !expect(']'))
+                            return false;
+                        haveMap = true;
+                    }
+                    else if (is(key, keyEnd, "responses"))
+                    {
+                        if (!expect('[') || (!peek(']') && (!pairs(responses, responseCount) || !expect(']'))))
+                            return false;
+                    }
+                    else if (is(key, keyEnd, "data"))
+                    {
+                        if (!text(dataBegin, dataEnd))
+                            return false;
+                    }
+                    else if (is(key, keyEnd, "globaldata"))
+                    {
+                        if (!text(globalBegin, globalEnd))
+                            return false;
+                    }
+                    else if (!skipValue(0))
+                        return false;
+                } while (peek(','));
+                return expect('}') && skipSpace() == end && haveMap && responseCount >= requestCount - 1;
+            }
+
+        private:
+            const char *p, *end;
+
+            const char *skipSpace()
+            {
+                while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n'))
+                    p++;
+                return p;
+            }
+            bool expect(char c)
+            {
+                if (skipSpace() == end || *p != c)
+                    return false;
+                p++;
+                return true;
+            }
+            // consumes c if it comes next
+            bool peek(char c)
+            {
+                return skipSpace() != end && *p == c && ++p;
+            }
+            static bool is(const char *begin, const char *end, const char *word)
+            {
+                size_t n = strlen(word);
+                return (size_t)(end - begin) == n && !memcmp(begin, word, n);
+            }
+            // a string without escapes
+            bool text(const char *&begin, const char *&stop)
+            {
+                if (!expect('"'))
+                    return false;
+                begin = p;
+                while (p < end && *p != '"')
+                    if (*p++ == '\\')
+                        return false;
+                if (p == end)
+                    return false;
+                stop = p++;
+                return true;
+            }
+            bool integer(int &value)
+            {
+                skipSpace();
+                bool negative = p < end && *p == '-';
+                if (negative)
+                    p++;
+                if (p == end || *p < '0' || *p > '9')
+                    return false;
+                long long v = 0;
+                while (p < end && *p >= '0' && *p <= '9' && v < (1LL << 40))
+                    v = v * 10 + (*p++ - '0');
+                if (p < end && (*p == '.' || *p == 'e' || *p == 'E' || (*p >= '0' && *p <= '9')))
+                    return false;
+                v = negative ? -v : v;
+                if (v < std::numeric_limits<int>::min() || v > std::numeric_limits<int>::max())
+                    return false;
+                value = (int)v;
+                return true;
+            }
+            bool intArray(int *out, int n)
+            {
+                if (!expect('['))
+                    return false;
+                for (int i = 0; i < n; i++)
+                    if ((i && !expect(',')) || !integer(out[i]))
+                        return false;
+                return expect(']');
+            }
+            // the map object that opens the requests
+            bool mapObject()
+            {
+                int seen = 0;
+                if (!expect('{'))
+                    return false;
+                do
+                {
+                    const char *key, *keyEnd;
+                    if (!text(key, keyEnd) || !expect(':'))
+                        return false;
+                    if (is(key, keyEnd, "brickfield") && intArray(brick, 3))
+                        seen |= 1;
+                    else if (is(key, keyEnd, "waterfield") && intArray(water, 3))
+                        seen |= 2;
+                    else if (is(key, keyEnd, "steelfield") && intArray(steel, 3))
+                        seen |= 4;
+                    else if (is(key, keyEnd, "mySide") && integer(mySide))
+                        seen |= 8;
+                    else
+                        return false;
+                } while (peek(','));
+                requestCount = 1;
+                return expect('}') && seen == 15 && (mySide == 0 || mySide == 1);
+            }
+            // a comma separated run of [a, b] pairs, appended to out from count on
+            bool pairs(int (*out)[tankPerSide], int &count)
+            {
+                do
+                {
+                    if (count == maxHistory || !intArray(out[count++], tankPerSide))
+                        return false;
+                } while (peek(','));
+                return true;
+            }
+            // any value of a key we do not use
+            bool skipValue(int depth)
+            {
+                if (depth > 32 || skipSpace() == end)
+                    return false;
+                const char *begin, *stop;
+                if (*p == '"')
+                    return text(begin, stop);
+                if (*p == '{' || *p == '[')
+                {
+                    char close = *p++ == '{' ? '}' : ']';
+                    if (peek(close))
+                        return true;
+                    do
+                    {
+                        if (close == '}' && (!text(begin, stop) || !expect(':')))
+                            return false;
+                        if (!skipValue(depth + 1))
+                            return false;
+                    } while (peek(','));
+                    return expect(close);
+                }
+                begin = p;
+                while (p < end && *p != ',' && *p != '}' && *p != ']' && *p != ' ')
+                    p++;
+                return p > begin;
+            }
+        };
+        RequestParser requestParser;
+
+        // replays a parsed history into a new field, like _processRequestOrResponse;
+        // the judge validated these turns, so they take the trusted path
+        void _applyRequests(const RequestParser &request)
+        {
+            int brick[3], water[3], steel[3];
+            memcpy(brick, request.brick, sizeof(brick));
+            memcpy(water, request.water, sizeof(water));
+            memcpy(steel, request.steel, sizeof(steel));
+            field = new TankField(brick, water, steel, request.mySide);
+            for (int i = 1; i < request.requestCount; i++)
+            {
+                for (int tank = 0; tank < tankPerSide; tank++)
+                {
+                    field->nextAction[field->mySide][tank] = (Action)request.responses[i - 1][tank];
+                    field->nextAction[1 - field->mySide][tank] = (Action)request.requests[i][tank];
+                }
+                field->ReplayAction();
+            }
+        }
+
+        struct ReplayTimer
+        {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            ~ReplayTimer()
+            {
+                replayMicroseconds = std::chrono::duration<double, std::micro>(
+                    std::chrono::steady_clock::now() - start).count();
+            }
+        };
+
+        // 输出用的缓冲区，跨回合复用
+        string outputBuffer;
+
+        // 把 text 作为 JSON 字符串（带引号、转义）追加到 out
+        void _appendQuoted(string &out, const string &text)
+        {
+            static const char hex[] = "0123456789abcdef";
+            out += '"';
+            const char *run = text.data(), *end = run + text.size();
+            for (const char *p = run; p < end; p++)
+            {
+                unsigned char c = *p;
+                if (c >= 0x20 && c != '"' && c != '\\')
+                    continue;
+                out.append(run, p);
+                run = p + 1;
+                switch (c)
+                {
+                case '"': out += "\\\""; break;
+                case '\\': out += "\\\\"; break;
+                case '\b': out += "\\b"; break;
+                case '\f': out += "\\f"; break;
+                case '\n': out += "\\n"; break;
+                case '\r': out += "\\r"; break;
+                case '\t': out += "\\t"; break;
+                default:
+                    out += "\\u00";
+                    out += hex[c >> 4];
+                    out += hex[c & 15];
+                }
+            }
+            out.append(run, end);
+            out += '"';
+        }
+
+        // 整块写到标准输出：POSIX 下是一次 write 系统调用
+        void _writeOutput(const string &text)
+        {
+            // cout 与 stdio 同步，先把之前缓冲的输出冲掉，保持顺序
+            fflush(stdout);
+#ifdef _WIN32
+            fwrite(text.data(), 1, text.size(), stdout);
+            fflush(stdout);
+#else
+            for (size_t done = 0; done < text.size();)
+            {
+                ssize_t written = write(STDOUT_FILENO, text.data() + done, text.size() - done);
+                if (written < 0 && errno == EINTR)
+                    continue;
+                if (written <= 0)
+                    break;
+                done += written;
+            }
+#endif
+        }
+
         // 请使用 SubmitAndExit 或者 SubmitAndDontExit
+        // 回复的形状固定，不经过 Json::Value 和 Writer，直接拼成一行
         void _submitAction(Action tank0, Action tank1, string debug = "", string data = "", string globalData = "")
         {
-            Json::Value output(Json::objectValue), response(Json::arrayValue);
-            response[0U] = tank0;
-            response[1U] = tank1;
-            output["response"] = response;
+            string &output = outputBuffer;
+            output.clear();
+            output.reserve(64 + debug.size() + data.size() + globalData.size());
+            output += "{\"response\":[";
+            output += std::to_string((int)tank0);
+            output += ',';
+            output += std::to_string((int)tank1);
+            output += ']';
             if (!debug.empty())
-                output["debug"] = debug;
+            {
+                output += ",\"debug\":";
+                _appendQuoted(output, debug);
+            }
             if (!data.empty())
-                output["data"] = data;
+            {
+                output += ",\"data\":";
+                _appendQuoted(output, data);
+            }
             if (!globalData.empty())
-                output["globalData"] = globalData;
-            cout << writer.write(output) << endl;
+            {
+                output += ",\"globaldata\":";
+                _appendQuoted(output, globalData);
+            }
+            output += "}\n";
+            _writeOutput(output);
         }
     }
 
@@ -683,6 +1314,7 @@ namespace TankGame
     {
         Json::Value input;
         string inputString;
+        TRACE_BEGIN(ParseInput);
         do
         {
             getline(in, inputString);
@@ -701,11 +1333,39 @@ namespace TankGame
             } while (newString != "}" && newString != "]");
         }
 #endif
+        Internals::RequestParser &request = Internals::requestParser;
+        if (request.parse(inputString.data(), inputString.data() + inputString.size()))
+        {
+            TRACE_END(ParseInput);
+            outData.clear();
+            outGlobalData.clear();
+            if (request.dataBegin)
+                outData.assign(request.dataBegin, request.dataEnd);
+            if (request.globalBegin)
+                outGlobalData.assign(request.globalBegin, request.globalEnd);
+            if (globalDataLoader)
+                globalDataLoader(outGlobalData);
+            TRACE_SPAN(ReplayHistory);
+            Internals::ReplayTimer timer;
+            Internals::_applyRequests(request);
+            return;
+        }
         Internals::reader.parse(inputString, input);
+        TRACE_END(ParseInput);
+        if (input.isObject() && input["requests"].isArray())
+        {
+            outData = input["data"].asString();
+            outGlobalData = input["globaldata"].asString();
+            if (globalDataLoader)
+                globalDataLoader(outGlobalData);
+        }
+        TRACE_SPAN(ReplayHistory);
+        Internals::ReplayTimer timer;
 
         if (input.isObject())
         {
-            Json::Value requests = input["requests"], responses = input["responses"];
+            // 只取引用，不复制整段历史
+            const Json::Value &requests = input["requests"], &responses = input["responses"];
             if (!requests.isNull() && requests.isArray())
             {
                 size_t i, n = requests.size();
@@ -715,8 +1375,6 @@ namespace TankGame
                     if (i < n - 1)
                         Internals::_processRequestOrResponse(responses[i], false);
                 }
-                outData = input["data"].asString();
-                outGlobalData = input["globaldata"].asString();
                 return;
             }
         }
@@ -732,9 +1390,9 @@ namespace TankGame
 
     // 提交决策，下回合时程序继续运行（需要在 Botzone 上提交 Bot 时选择“允许长时运行”）
     // 如果游戏结束，程序会被系统杀死
-    void SubmitAndDontExit(Action tank0, Action tank1)
+    void SubmitAndDontExit(Action tank0, Action tank1, string debug = "", string data = "", string globalData = "")
     {
-        Internals::_submitAction(tank0, tank1);
+        Internals::_submitAction(tank0, tank1, debug, data, globalData);
         field->nextAction[field->mySide][0] = tank0;
         field->nextAction[field->mySide][1] = tank1;
         cout << ">>>BOTZONE_REQUEST_KEEP_RUNNING<<<" << endl;
@@ -777,158 +1435,158 @@ std::ostream & operator << (std::ostream &out, Action &b)
 
 double sigmoid(double x) { return 1./(1+exp(-x)); }
 
-class Judger {
+// Distance fields towards a base depend on the terrain and the attacking side only
+// (tanks are ignored), so they are computed once per brick layout and reused.
+class BaseDistanceCache
+{
     public:
-        TankGame::TankField *field;
-        bool havebeenDebug = 1; 
-        int spfa(int side, int  id)
+        typedef double DistanceMap[TankGame::fieldHeight][TankGame::fieldWidth];
+        struct Key
         {
-            std::queue< std::pair<int, int> > q;
-            bool vis[TankGame::fieldHeight][TankGame::fieldWidth] = {0};
-            int cost[TankGame::fieldHeight][TankGame::fieldWidth];
-            memset(cost, 127, sizeof(cost));
-            cost[field->tankY[side][id]][field->tankX[side][id]] = 0;
-            q.push(std::pair<int,int>(field->tankY[side][id], field->tankX[side][id]));
-            vis[field->tankY[side][id]][field->tankX[side][id]]= 1; 
-            while (!q.empty()) {
-                int y = q.front().first;
-                int x = q.front().second;
-                q.pop();
-                vis[y][x] = 0;
-                for (int k=0; k<4; ++k)
-                {
-                    int yy = y + TankGame::dy[k];
-                    int xx = x + TankGame::dx[k]; 
-                    if (!TankGame::CoordValid(xx, yy)) continue;
-                    if (field->gameField[yy][xx] == TankGame::Steel
-                        || field->gameField[yy][xx]== TankGame::Water
-                        || field->gameField[yy][xx] ==TankGame::Red0
-                        || field->gameField[yy][xx] ==TankGame::Red1
-                        || field->gameField[yy][xx] == TankGame::Blue0
-                        || field->gameField[yy][xx] == TankGame::Blue1)
-                        continue;
-                    int c = 0;
-                    if (field->gameField[yy][xx] == TankGame::Brick)
-                        c = 2;
-                    else c = 1;
-                    if (cost[y][x] + c < cost[yy][xx])
-                    {
-                        cost[yy][xx] = cost[y][x] + c;
-                        if (!vis[yy][xx])
-                        {
-                            vis[yy][xx] = 1;
-                            q.push(std::pair<int, int> (yy, xx));
-                        }
-                    }
-                }
+            unsigned long long brick[2];
+            const TankGame::StaticMap *terrain;
+            int side, row;
+            bool operator== (const Key &b) const
+            {
+                return brick[0] == b.brick[0] && brick[1] == b.brick[1]
+                    && terrain == b.terrain && side == b.side && row == b.row;
             }
-            int x = TankGame::baseX[1-side];
-            int y = TankGame::baseY[1-side];
-            int xyDelta = abs(x - field->tankX[side][id]) + abs(y - field->tankY[side][id]);
-            int min = cost[y][x];
-            for (int k = 0; k < 4; ++k) {
-                int co = 0;
-                int xx = x, yy =  y;
-                for (int i=1; 1; ++i)
+        };
+        static const int SIZE = 4096;
+        long long hits = 0, misses = 0;
+        BaseDistanceCache() : entries(SIZE) {}
+
+        // distance from every cell to the base of 1-side; row is the brick-cost
+        // threshold (mnY for side 0, mxY for side 1) used by Judger::dp
+        const DistanceMap &get(TankGame::TankField *field, int side, int row)
+        {
+            Key key = makeKey(field, side, row);
+            Entry &e = slot(key);
+            if (e.used && e.key == key)
+            {
+                ++hits;
+                return e.dis;
+            }
+            ++misses;
+            e.used = true;
+            e.key = key;
+            build(field, side, row, e.dis);
+            return e.dis;
+        }
+        void clear()
+        {
+            for (auto &e : entries)
+                e.used = false;
+            hits = misses = 0;
+        }
+        // the map stored under key, or null; does not count as a hit or miss
+        const DistanceMap *find(const Key &key)
+        {
+            Entry &e = slot(key);
+            return e.used && e.key == key ? &e.dis : nullptr;
+        }
+        // seeds a map computed elsewhere (see MapTableStore)
+        void put(const Key &key, const DistanceMap &dis)
+        {
+            Entry &e = slot(key);
+            e.used = true;
+            e.key = key;
+            memcpy(e.dis, dis, sizeof(DistanceMap));
+        }
+        static Key makeKey(TankGame::TankField *field, int side, int row)
+        {
+            // build() walks the StaticMap tables, which a default-constructed field lacks
+            if (!field->terrain)
+                throw std::runtime_error("BaseDistanceCache: field has no terrain");
+            Key key = {};
+            key.terrain = field->terrain;
+            key.side = side;
+            key.row = row;
+            for (int y = 0; y < TankGame::fieldHeight; ++y)
+                for (int x = 0; x < TankGame::fieldWidth; ++x)
                 {
-                    xx += TankGame::dx[k];
-                    yy += TankGame::dy[k];
-                    if (field->gameField[yy][xx] == TankGame::Steel
-                    || !TankGame::CoordValid(xx, yy))
-                        break;
-                    if (field->gameField[yy][xx] == TankGame::Brick)
-                        co += 2;
-                    min = std::min(min, cost[yy][xx] + co);
+                    int i = y * TankGame::fieldWidth + x;
+                    if (field->gameField[y][x] & TankGame::Brick)
+                        key.brick[i >> 6] |= 1ULL << (i & 63);
                 }
-            }
-            // if (side == 0)
-            // {
-            //     debug << field->tankX[side][id] << ' ' << field->tankY[side][id] << ": " << min<< ' ' << xyDelta << endl;
-            // }
-            return min + xyDelta / 2;
+            return key;
         }
-        double getDisScore(TankGame::TankField *Field)
+    private:
+        struct Entry
         {
-            // Field->DebugPrint();
+            Key key;
+            bool used = false;
+            DistanceMap dis;
+        };
+        std::vector<Entry> entries;
 
-            
-            int side = Field->mySide;
-            TankGame::GameResult res = Field->GetGameResult();
-            int D1, D2;
-            field = Field;
-            D1 = spfa(side, 0);
-            D2 = spfa(side, 1);
-            if (D1 > D2) std::swap(D1, D2);
-            // cout << D1 << ", " << D2 << endl;
-            double val =  20- (1.*D1 + 0.5 * D2);
-            return val;
+        Entry &slot(const Key &key)
+        {
+            unsigned long long h = (key.brick[0] ^ key.brick[1] * 0x9E3779B97F4A7C15ULL
+                ^ (key.terrain ? key.terrain->fingerprint : 0)) * 0xFF51AFD7ED558CCDULL
+                ^ (unsigned long long)(key.side * 16 + key.row + 1) * 0x94D049BB133111EBULL;
+            return entries[(h ^ (h >> 29)) & (SIZE - 1)];
         }
-        double dp(int side)
+        static void build(TankGame::TankField *field, int side, int row, DistanceMap &dis)
         {
+            const TankGame::StaticMap *terrain = field->terrain;
             double cost[TankGame::fieldHeight][TankGame::fieldWidth];
-            double dis[TankGame::fieldHeight][TankGame::fieldWidth];
-            bool vs[TankGame::fieldHeight][TankGame::fieldWidth];
+            bool vs[TankGame::fieldHeight][TankGame::fieldWidth] = {};
             using pii  = typename std::pair<int, int>;
 
-            pii q[85*10];
+            // every cell is queued at most once at a time, so a ring of 128 is enough
+            pii q[128];
             int head = 0, tail = 0;
 
-            memset(dis, 127, sizeof(dis));
-            memset(vs, 0, sizeof(vs));
-            int mnY = std::min(field->tankY[side][0], field->tankY[side][1]);
-            int mxY = std::max(field->tankY[side][0], field->tankY[side][1]);
-            
+            for (int i = 0; i<TankGame::fieldHeight; ++i)
+                for (int j= 0; j<TankGame::fieldWidth; ++j)
+                    dis[i][j] = 1e9;
             dis[TankGame::baseY[1-side]][TankGame::baseX[1-side]] = 0;
 
             for (int k=0; k<4; ++k)
             {
-                int y = TankGame::baseY[1], x = TankGame::baseX[1];
-                double cost = 1, val = 1.; 
-                for (; 1; )
+                int y = TankGame::baseY[1-side], x = TankGame::baseX[1-side];
+                double cost = 1, val = 1.;
+                for (int i = terrain->rayLength[y][x][k]; i > 0; --i)
                 {
                     y = y + TankGame::dy[k], x = x + TankGame::dx[k];
-                    if ((!TankGame::CoordValid(x, y))
-                    ||  (field->gameField[y][x] == TankGame::Steel)
-                    ||  (field->gameField[y][x] & (8+16+32+64)) )
-                        break;
-                    if (field->gameField[y][x] == TankGame::Water)
+                    if (field->gameField[y][x] & TankGame::Water)
                         continue;
                     dis[y][x] = cost;
                     if (!vs[y][x])
                     {
                         vs[y][x] = 1;
-                        q[tail] = pii(y, x); tail += 1;
+                        q[tail++ & 127] = pii(y, x);
                     }
-                    if (field->gameField[y][x] == TankGame::Brick)
+                    if (field->gameField[y][x] & TankGame::Brick)
                        val = val * 1.1, cost += val*2;
                 }
             }
-            
+
             for (int i = 0; i<TankGame::fieldHeight; ++i)
                 for (int j= 0; j<TankGame::fieldWidth; ++j)
                 {
-                    if ((field->gameField[i][j] == TankGame::Steel)
-                    || (field->gameField[i][j] == TankGame::Water)
-                    || (field->gameField[i][j] & (8+16+32+64))
-                    )
+                    if (!terrain->passable[i][j])
                         cost[i][j] = 100;
-                    if (field->gameField[i][j] == TankGame::Brick)
+                    else if (field->gameField[i][j] & TankGame::Brick)
                     {
                         if (side == 0)
-                            cost[i][j] = i >= mnY? 1 : 2;
+                            cost[i][j] = i >= row? 1 : 2;
                         else
-                            cost[i][j] = i <= mxY? 1: 2;
+                            cost[i][j] = i <= row? 1: 2;
                     }
+                    else
+                        cost[i][j] = 0;
                 }
             while (head < tail)
             {
-                int y = q[head].first, x = q[head].second;
+                int y = q[head & 127].first, x = q[head & 127].second;
                 head += 1;
                 vs[y][x] = 0;
                 for (int k=0; k<4; ++k)
                 {
                     int xx = x + TankGame::dx[k];
-                    int yy = y + TankGame::dy[k]; 
+                    int yy = y + TankGame::dy[k];
                     if (TankGame::CoordValid(xx, yy) == 0)
                         continue;
                     if (dis[yy][xx] > dis[y][x] + cost[y][x] + 1)
@@ -937,14 +1595,266 @@ class Judger {
                         if (vs[yy][xx] == 0)
                         {
                             vs[yy][xx] = 1;
-                            q[tail] = pii(yy, xx);
-                            tail += 1;
+                            q[tail++ & 127] = pii(yy, xx);
+                        }
+                    }
+                }
+            }
+        }
+};
+
+// Lock-free transposition table for Judger::getScore. Each slot keeps key^value
+// next to the value, so a slot torn by a concurrent writer simply misses.
+class EvalCache
+{
+    public:
+        std::atomic<long long> probes, hits;
+        explicit EvalCache(size_t bytes) { resize(bytes); }
+
+        // the table uses the largest power-of-two slot count that fits in bytes;
+        // less than one slot turns the cache off
+        void resize(size_t bytes)
+        {
+            size_t n = bytes >= sizeof(Slot);
+            while (n && n * 2 * sizeof(Slot) <= bytes)
+                n *= 2;
+            slots = std::vector<Slot>(n);
+            mask = n - 1;
+            probes = hits = 0;
+        }
+        size_t bytes() const { return slots.size() * sizeof(Slot); }
+        bool enabled() const { return !slots.empty(); }
+        void clear() { resize(bytes()); }
+        double hitRate() const { return probes ? 1. * hits / probes : 0; }
+
+        // the slot comes from the low bits of key; the check uses key | 1, so an
+        // empty slot (check ^ data == 0) never matches
+        bool probe(unsigned long long key, double &value)
+        {
+            if (slots.empty())
+                return false;
+            Slot &slot = slots[key & mask];
+            unsigned long long data = slot.data.load(std::memory_order_relaxed);
+            unsigned long long check = slot.check.load(std::memory_order_relaxed);
+            probes.fetch_add(1, std::memory_order_relaxed);
+            if ((check ^ data) != (key | 1))
+                return false;
+            hits.fetch_add(1, std::memory_order_relaxed);
+            memcpy(&value, &data, sizeof(value));
+            return true;
+        }
+        void store(unsigned long long key, double value)
+        {
+            if (slots.empty())
+                return;
+            unsigned long long data;
+            memcpy(&data, &value, sizeof(value));
+            Slot &slot = slots[key & mask];
+            slot.check.store((key | 1) ^ data, std::memory_order_relaxed);
+            slot.data.store(data, std::memory_order_relaxed);
+        }
+    private:
+        struct Slot
+        {
+            std::atomic<unsigned long long> check, data;
+            Slot() : check(0), data(0) {}
+        };
+        std::vector<Slot> slots;
+        size_t mask;
+};
+
+// Weights of Judger::getScore. The defaults are the hand-picked values;
+// tools/tuner.cpp fits new ones and prints them as a parameter block.
+struct JudgerParams
+{
+    double secondTank = 0.8;     // weight of the farther tank's distance (D2)
+    double protectBricks = 0.3;  // weight of the bricks shielding the enemy base
+    double aliveEven = 5;        // alive-tank difference weight when the race is even
+    double aliveAhead = 3;       // ... when we are closer to the enemy base
+    double aliveBehind = 20;     // ... when we are farther from it
+    double evenThreshold = 0.2;  // relative distance gap below which the race is even
+
+    // "name=value" pairs separated by spaces, commas or newlines; unknown names
+    // and malformed entries are rejected and leave the block unchanged
+    bool load(const string &block)
+    {
+        JudgerParams next = *this;
+        string text = block;
+        std::replace(text.begin(), text.end(), ',', ' ');
+        std::istringstream in(text);
+        string entry;
+        while (in >> entry)
+        {
+            size_t eq = entry.find('=');
+            double *slot = eq == string::npos ? nullptr : next.find(entry.substr(0, eq));
+            if (!slot)
+                return false;
+            char *end;
+            double value = strtod(entry.c_str() + eq + 1, &end);
+            if (*end || end == entry.c_str() + eq + 1)
+                return false;
+            *slot = value;
+        }
+        *this = next;
+        return true;
+    }
+    string dump() const
+    {
+        std::ostringstream out;
+        out.precision(6);
+        for (int i = 0; i < count; i++)
+            out << (i ? " " : "") << names()[i] << '=' << value(i);
+        return out.str();
+    }
+
+    static const int count = 6;
+    static const char * const *names()
+    {
+        static const char * const n[count] = {
+            "secondTank", "protectBricks", "aliveEven", "aliveAhead", "aliveBehind", "evenThreshold"
+        };
+        return n;
+    }
+    // the weights in the order of names()
+    static double JudgerParams::* const *members()
+    {
+        static double JudgerParams::* const m[count] = {
+            &JudgerParams::secondTank, &JudgerParams::protectBricks, &JudgerParams::aliveEven,
+            &JudgerParams::aliveAhead, &JudgerParams::aliveBehind, &JudgerParams::evenThreshold
+        };
+        return m;
+    }
+    double &value(int i) { return this->*members()[i]; }
+    double value(int i) const { return this->*members()[i]; }
+    double *find(const string &name)
+    {
+        for (int i = 0; i < count; i++)
+            if (name == names()[i])
+                return &value(i);
+        return nullptr;
+    }
+};
+
+// tuned weights pasted from tools/tuner.cpp; empty keeps the defaults
+const char *judgerParamBlock = "";
+
+class Judger {
+    public:
+        TankGame::TankField *field;
+        JudgerParams params;
+        BaseDistanceCache baseDistance;
+        // Off by default: in MCTS search (20k simulations on 24 self-play
+        // positions) only ~0.5% of the probes hit and simulations/s did not
+        // improve, which does not pay for hashing every evaluated position.
+        // Sizes up to a few MB stay well below the 256 MB limit.
+        static const size_t defaultEvalCacheBytes = 0;
+        EvalCache evalCache{defaultEvalCacheBytes};
+
+        // cached scores were computed with the old weights
+        void setParams(const JudgerParams &p)
+        {
+            params = p;
+            evalCache.clear();
+        }
+        int spfa(int side, int  id)
+        {
+            std::queue< std::pair<int, int> > q;
+            bool vis[TankGame::fieldHeight][TankGame::fieldWidth] = {0};
+            int cost[TankGame::fieldHeight][TankGame::fieldWidth];
+            memset(cost, 127, sizeof(cost));
+            cost[field->tankY[side][id]][field->tankX[side][id]] = 0;
+            q.push(std::pair<int,int>(field->tankY[side][id], field->tankX[side][id]));
+            vis[field->tankY[side][id]][field->tankX[side][id]]= 1; 
+            while (!q.empty()) {
+                int y = q.front().first;
+                int x = q.front().second;
+                q.pop();
+                vis[y][x] = 0;
+                for (int k=0; k<4; ++k)
+                {
+                    int yy = y + TankGame::dy[k];
+                    int xx = x + TankGame::dx[k]; 
+                    if (!TankGame::CoordValid(xx, yy)) continue;
+                    if (field->gameField[yy][xx] == TankGame::Steel
+                        || field->gameField[yy][xx]== TankGame::Water
+                        || field->gameField[yy][xx] ==TankGame::Red0
+                        || field->gameField[yy][xx] ==TankGame::Red1
+                        || field->gameField[yy][xx] == TankGame::Blue0
+                        || field->gameField[yy][xx] == TankGame::Blue1)
+                        continue;
+                    int c = 0;
+                    if (field->gameField[yy][xx] == TankGame::Brick)
+                        c = 2;
+                    else c = 1;
+                    if (cost[y][x] + c < cost[yy][xx])
+                    {
+                        cost[yy][xx] = cost[y][x] + c;
+                        if (!vis[yy][xx])
+                        {
+                            vis[yy][xx] = 1;
+                            q.push(std::pair<int, int> (yy, xx));
                         }
                     }
                 }
             }
-            double d1 = dis[field->tankY[side][0]][field->tankX[side][0]];
-            double d2 = dis[field->tankY[side][1]][field->tankX[side][1]];
+            int x = TankGame::baseX[1-side];
+            int y = TankGame::baseY[1-side];
+            int xyDelta = abs(x - field->tankX[side][id]) + abs(y - field->tankY[side][id]);
+            int min = cost[y][x];
+            for (int k = 0; k < 4; ++k) {
+                int co = 0;
+                int xx = x, yy =  y;
+                for (int i=1; 1; ++i)
+                {
+                    xx += TankGame::dx[k];
+                    yy += TankGame::dy[k];
+                    if (!TankGame::CoordValid(xx, yy)
+                    || field->gameField[yy][xx] == TankGame::Steel)
+                        break;
+                    if (field->gameField[yy][xx] == TankGame::Brick)
+                        co += 2;
+                    min = std::min(min, cost[yy][xx] + co);
+                }
+            }
+            // if (side == 0)
+            // {
+            //     debug << field->tankX[side][id] << ' ' << field->tankY[side][id] << ": " << min<< ' ' << xyDelta << endl;
+            // }
+            return min + xyDelta / 2;
+        }
+        double getDisScore(TankGame::TankField *Field)
+        {
+            // Field->DebugPrint();
+
+            
+            int side = Field->mySide;
+            TankGame::GameResult res = Field->GetGameResult();
+            int D1, D2;
+            field = Field;
+            D1 = spfa(side, 0);
+            D2 = spfa(side, 1);
+            if (D1 > D2) std::swap(D1, D2);
+            // cout << D1 << ", " << D2 << endl;
+            double val =  20- (1.*D1 + 0.5 * D2);
+            return val;
+        }
+        // a destroyed tank no longer contributes to the attack
+        static constexpr double deadTankDistance = 30;
+        double tankDistance(const BaseDistanceCache::DistanceMap &dis, int side, int id)
+        {
+            if (!field->tankAlive[side][id])
+                return deadTankDistance;
+            return dis[field->tankY[side][id]][field->tankX[side][id]];
+        }
+        double dp(int side)
+        {
+            int mnY = std::min(field->tankY[side][0], field->tankY[side][1]);
+            int mxY = std::max(field->tankY[side][0], field->tankY[side][1]);
+            const BaseDistanceCache::DistanceMap &dis =
+                baseDistance.get(field, side, side == 0 ? mnY : mxY);
+
+            double d1 = tankDistance(dis, side, 0);
+            double d2 = tankDistance(dis, side, 1);
             if (d1 > d2) std::swap(d1, d2);
             
             double protectBricks = 0;
@@ -959,8 +1869,6 @@ class Judger {
                     break;
                 }
             }
-            if (havebeenDebug == 0)
-                cout << y1 << endl;
             y2 = y1;
             protectBricks = y1;
 
@@ -969,9 +1877,6 @@ class Judger {
                 x1 -= 1, x2 += 1;
                 if (x1 < 0) break;
                 int y1_ = 0, y2_ = 0;
-                if (havebeenDebug == 0)
-                    cout << y + TankGame::dy[side*2] * y1_ << ' ' << x1 << endl
-                    << y + TankGame::dy[side*2] * y2_ << ' ' << x2 << endl;
                 for (; 1; ++y1_)
                     if (field->gameField[y + TankGame::dy[side*2] * y1_][x1] != TankGame::Brick)
                     {
@@ -986,30 +1891,12 @@ class Judger {
                     }
                 y1 = std::min(y1, y1_);
                 y2 = std::min(y1, y2_);
-                if (havebeenDebug==0)
-                    cout << y1 << ' ' << y2 << endl;
                 protectBricks += std::max(0, y1 + y2);
             }
-            if (!havebeenDebug) {
-                havebeenDebug = 1;
-                field->DebugPrint();
-                for (int i=0; i<TankGame::fieldHeight; ++i)
-                {
-                    for (int j=0; j<TankGame::fieldWidth; ++j)
-                        cout << dis[i][j] << ' ';
-                    cout << endl;
-                }
-                for (int i=0; i<TankGame::fieldHeight; ++i)
-                {
-                    for (int j=0; j<TankGame::fieldWidth; ++j)
-                        cout << cost[i][j] << ' ';
-                    cout << endl; 
-                }
-                cout << "D1 = " << d1 << " " <<  "D2 = " << d2 << endl;
-                cout << "protectBricks = " << protectBricks << endl;
-                cout << "return value is " << d1 + 0.8 * d2  - protectBricks * 0.3 << endl;
-            }
-            return d1 + 0.8 * d2  - protectBricks * 0.3;
+            TRACE(DpDistance, side, 0, 0, d1, d2);
+            double value = d1 + params.secondTank * d2 - protectBricks * params.protectBricks;
+            TRACE(DpResult, side, 0, 0, protectBricks, value);
+            return value;
         }
         double deltaScale(double a, double b) 
         {
@@ -1027,6 +1914,14 @@ class Judger {
                 else if (res == side) return 1;
                 else return 0;
             }
+            unsigned long long key = 0;
+            double cached;
+            if (evalCache.enabled())
+            {
+                key = TankGame::HashMix(Field->Hash() + side);
+                if (evalCache.probe(key, cached))
+                    return cached;
+            }
             int myAlive = 0, eneAlive = 0;
             for (int i=0; i<2; ++i) {
                 myAlive += Field->tankAlive[side][i];
@@ -1045,16 +1940,18 @@ class Judger {
             double val = 0; 
             if (side == 0) val = down - up;
             else val = up - down; 
-            if (deltaScale(up, down) < 0.2)
-                val += 5.*(myAlive-eneAlive);
+            if (deltaScale(up, down) < params.evenThreshold)
+                val += params.aliveEven * (myAlive-eneAlive);
             else
             {
                 if ((up < down) == (side == 0))
-                    val += 3. * (myAlive - eneAlive);
+                    val += params.aliveAhead * (myAlive - eneAlive);
                 else
-                    val += 20. * (myAlive - eneAlive);
+                    val += params.aliveBehind * (myAlive - eneAlive);
             }
 
+            if (evalCache.enabled())
+                evalCache.store(key, sigmoid(val));
             return sigmoid(val);
         }
 
@@ -1068,75 +1965,136 @@ class Judger {
             }
             return myAlive - eneAlive;
         }
-        std::vector< std::pair<Action, double> > getBestBlocks(TankGame::TankField *Field, int t, int w = 64)
+        typedef std::pair<Action, double> RankedAction;
+        static const int maxJointActions = 81;
+
+        // static score of every single-tank action of side (index act + 1), or
+        // -inf when the action is invalid; dead tanks may only Stay
+        void scoreTankActions(TankGame::TankField *Field, int side, double score[TankGame::tankPerSide][9])
         {
-            int side = Field->mySide;
-            field = Field;
-            std::vector< std::pair<Action, double> > returnV;
-            for (int i = -1; i< 8; ++i)
-                for (int j = -1; j<8; ++j)
+            const double invalid = -std::numeric_limits<double>::infinity();
+            const double winShot = 100, enemyTankShot = 20, duelShot = 10, roadBrickShot = 3,
+                wastedShot = -1, suicide = -15, threatenBase = 5;
+            const TankGame::StaticMap *terrain = Field->terrain;
+            int enemy = 1 - side;
+
+            // cells an enemy tank could shoot this turn; our own tanks do not shield
+            // each other since they may move out of the way
+            bool danger[TankGame::fieldHeight][TankGame::fieldWidth] = {};
+            for (int e = 0; e < TankGame::tankPerSide; ++e)
+            {
+                if (!Field->tankAlive[enemy][e] || Field->previousActions[Field->currentTurn - 1][enemy][e] > TankGame::Left)
+                    continue;
+                for (int dir = 0; dir < 4; ++dir)
                 {
-                    Field->nextAction[side][0 ] = (TankGame::Action) i;
-                    Field->nextAction[side][1 ] = (TankGame::Action) j;
-                    Field->nextAction[1-side][0] = (TankGame::Action) -1;
-                    Field->nextAction[1-side][1] = (TankGame::Action) -1;
-                    if (Field->ActionIsValid())
-                        returnV.push_back(std::pair<Action, double> (Action(i, j), 1));
+                    int x = Field->tankX[enemy][e], y = Field->tankY[enemy][e];
+                    for (int i = terrain->rayLength[y][x][dir]; i > 0; --i)
+                    {
+                        x += TankGame::dx[dir], y += TankGame::dy[dir];
+                        TankGame::FieldItem item = Field->gameField[y][x];
+                        danger[y][x] = true;
+                        if (item != TankGame::None && item != TankGame::Water && !(item & (TankGame::tankItemTypes[side][0] | TankGame::tankItemTypes[side][1])))
+                            break;
+                    }
                 }
-            // for (int i=-1; i<8; ++i)
-            //     for (int j =-1; j<8; ++j)  {
-            //         Field->nextAction[side][0] = (TankGame::Action) i;
-            //         Field->nextAction[side][1] = (TankGame::Action) j;
-            //         Field->nextAction[1-side][0] = (TankGame::Action) -1;
-            //         Field->nextAction[1-side][1] = (TankGame::Action) -1;
-            //         if (Field->ActionIsValid()) {
-            //             Field->DoAction();
-            //             TankGame::GameResult res = Field->GetGameResult();
-            //             double Dis = getDisScore(Field);
-            //             Field->Revert();
-            //             // std::vector<int> Deltas; 
-            //             // for (int h = -1; h<8; ++h)
-            //             //     for (int l = -1; l<8; ++l)
-            //             //     {
-            //             //         Field->nextAction[side][0] = (TankGame::Action) i;
-            //             //         Field->nextAction[side][1] = (TankGame::Action) j;
-            //             //         Field->nextAction[1-side][0] = (TankGame::Action) h;
-            //             //         Field->nextAction[1-side][1] = (TankGame::Action) l;
-            //             //         if (Field->ActionIsValid()) {
-            //             //             Field->DoAction();
-            //             //             Deltas.push_back(countAliveDelta(Field));
-            //             //             Field->Revert();
-            //             //         }
-            //             //     }
-            //             // if(Deltas.size() < w) w = Deltas.size();
-            //             // std::sort(Deltas.begin(), Deltas.end()); 
-            //             double Alive = 0;
-            //             // for (int h = 0; h<w; ++h)
-            //             //     Alive += Deltas[h];
-            //             // Alive /= 0.05 * w; 
-            //             returnV.push_back(std::pair<Action, double>(Action(i,j), sigmoid(Dis+Alive)));
-                    
-            //         }
-            //     }
-            
-            // using pAD = typename std::pair<Action, double>;
-            // std::sort(returnV.begin(), returnV.end(), 
-            // [](const pAD &a, const pAD &b)
-            // {
-            //     return a.second>b.second;
-            // });
+            }
 
-            while(returnV.size() > t)
-                returnV.pop_back();
+            int mnY = std::min(Field->tankY[side][0], Field->tankY[side][1]);
+            int mxY = std::max(Field->tankY[side][0], Field->tankY[side][1]);
+            const BaseDistanceCache::DistanceMap &dis = baseDistance.get(Field, side, side == 0 ? mnY : mxY);
 
-            // debug << "bestActions:" << endl;
-            // for (auto a:returnV)
-            // {
-            //     debug << a.first << ": " << a.second << ";   ";
-            // }
-            // debug << endl << "============================" << endl;
-            
-            return returnV;
+            for (int tank = 0; tank < TankGame::tankPerSide; ++tank)
+            {
+                for (int act = TankGame::Stay; act <= TankGame::LeftShoot; ++act)
+                    score[tank][act + 1] = invalid;
+                if (!Field->tankAlive[side][tank])
+                {
+                    score[tank][0] = 0;
+                    continue;
+                }
+                int x = Field->tankX[side][tank], y = Field->tankY[side][tank];
+                double stayRisk = danger[y][x] ? suicide : 0;
+                score[tank][0] = stayRisk;
+                for (int act = TankGame::Up; act <= TankGame::Left; ++act)
+                    if (Field->ActionIsValid(side, tank, (TankGame::Action)act))
+                    {
+                        int xx = x + TankGame::dx[act], yy = y + TankGame::dy[act];
+                        score[tank][act + 1] = dis[y][x] - dis[yy][xx]
+                            + (danger[yy][xx] ? suicide : 0)
+                            + (terrain->seesBase[enemy][yy][xx] ? threatenBase : 0);
+                    }
+                if (Field->previousActions[Field->currentTurn - 1][side][tank] > TankGame::Left)
+                    continue;
+                for (int act = TankGame::UpShoot; act <= TankGame::LeftShoot; ++act)
+                {
+                    int dir = act - TankGame::UpShoot, xx = x, yy = y;
+                    double value = wastedShot + stayRisk;
+                    for (int i = terrain->rayLength[y][x][dir]; i > 0; --i)
+                    {
+                        xx += TankGame::dx[dir], yy += TankGame::dy[dir];
+                        TankGame::FieldItem item = Field->gameField[yy][xx];
+                        if (item == TankGame::None || item == TankGame::Water)
+                            continue;
+                        if (item == TankGame::Base)
+                            value = yy == TankGame::baseY[enemy] ? winShot : -winShot;
+                        else if (item == TankGame::Brick)
+                            value = (terrain->seesBase[enemy][yy][xx] ? roadBrickShot : wastedShot) + stayRisk;
+                        else if (item & (TankGame::tankItemTypes[side][0] | TankGame::tankItemTypes[side][1]))
+                            value = -enemyTankShot;
+                        else
+                        {
+                            // the target may answer and cancel the shot, but it can no
+                            // longer hit us from there
+                            int e = TankGame::GetTankID(item);
+                            bool canAnswer = !TankGame::HasMultipleTank(item) &&
+                                Field->previousActions[Field->currentTurn - 1][enemy][e] <= TankGame::Left;
+                            value = canAnswer ? duelShot : enemyTankShot;
+                        }
+                        break;
+                    }
+                    score[tank][act + 1] = value;
+                }
+            }
+        }
+
+        // writes the best t valid joint actions of Field->mySide to out (in no
+        // particular order) and returns how many were written; without score
+        // every action gets 1 and the first t in enumeration order are kept
+        int rankActions(TankGame::TankField *Field, int t, RankedAction *out, bool score = true)
+        {
+            int side = Field->mySide;
+            field = Field;
+            double tankScore[TankGame::tankPerSide][9];
+            if (score)
+                scoreTankActions(Field, side, tankScore);
+            else
+                for (int tank = 0; tank < TankGame::tankPerSide; ++tank)
+                    for (int act = TankGame::Stay; act <= TankGame::LeftShoot; ++act)
+                        tankScore[tank][act + 1] = (!Field->tankAlive[side][tank] ? act == TankGame::Stay
+                            : Field->ActionIsValid(side, tank, (TankGame::Action)act))
+                            ? 0.5 : -std::numeric_limits<double>::infinity();
+            int n = 0;
+            for (int i = -1; i < 8; ++i)
+                if (tankScore[0][i + 1] != -std::numeric_limits<double>::infinity())
+                    for (int j = -1; j < 8; ++j)
+                        if (tankScore[1][j + 1] != -std::numeric_limits<double>::infinity())
+                            out[n++] = RankedAction(Action(i, j), tankScore[0][i + 1] + tankScore[1][j + 1]);
+            if (n > t)
+            {
+                std::nth_element(out, out + t, out + n, [](const RankedAction &a, const RankedAction &b)
+                {
+                    return a.second > b.second;
+                });
+                n = t;
+            }
+            return n;
+        }
+
+        std::vector< std::pair<Action, double> > getBestBlocks(TankGame::TankField *Field, int t, int w = 64)
+        {
+            RankedAction ranked[maxJointActions];
+            int n = rankActions(Field, t, ranked);
+            return std::vector<RankedAction>(ranked, ranked + n);
         }
 } fastJudger;
 
@@ -1144,14 +2102,410 @@ class FastAgent
 {
     public:
         int t; 
-        FastAgent(int ft)
-            : t(ft) {}
+        Judger *judger;
+        FastAgent(int ft, Judger *judger = &fastJudger)
+            : t(ft), judger(judger) {}
         Action getAction(TankGame::TankField *Field) {
-            auto bestBlocks = fastJudger.getBestBlocks(Field, t);
-            auto action = bestBlocks[rand() % bestBlocks.size()];
-            return action.first ;
+            // a uniform pick over every valid action needs no scoring
+            Judger::RankedAction bestBlocks[Judger::maxJointActions];
+            int n = judger->rankActions(Field, t, bestBlocks, t < Judger::maxJointActions);
+            return bestBlocks[rand() % n].first;
         }
 };
+static const char *base64Digits = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static bool Base64Decode(const char *text, vector<unsigned char> &out)
+{
+    unsigned buffer = 0;
+    int bits = 0;
+    out.clear();
+    for (; *text && *text != '='; text++)
+    {
+        const char *d = strchr(base64Digits, *text);
+        if (!d)
+            return false;
+        buffer = buffer << 6 | (unsigned)(d - base64Digits);
+        if ((bits += 6) >= 8)
+            out.push_back((unsigned char)(buffer >> (bits -= 8)));
+    }
+    return true;
+}
+
+static string Base64Encode(const unsigned char *data, size_t size)
+{
+    string text;
+    text.reserve((size + 2) / 3 * 4);
+    for (size_t i = 0; i < size; i += 3)
+    {
+        unsigned buffer = data[i] << 16 | (i + 1 < size ? data[i + 1] << 8 : 0) | (i + 2 < size ? data[i + 2] : 0);
+        for (int k = 0; k < 4; k++)
+            text += (size_t)k * 3 <= (size - i) * 4 ? base64Digits[buffer >> (18 - 6 * k) & 63] : '=';
+    }
+    return text;
+}
+
+// Bounds-checked reads from a serialized blob; after the first overrun ok is
+// false and every read returns zero
+struct ByteReader
+{
+    const unsigned char *p, *end;
+    bool ok;
+    ByteReader(const unsigned char *p, const unsigned char *end) : p(p), end(end), ok(true) {}
+    int byte()
+    {
+        if (p == end)
+            ok = false;
+        return ok ? *p++ : 0;
+    }
+    template <typename T>
+    T read()
+    {
+        T value = T();
+        if (end - p < (long)sizeof(value))
+            ok = false;
+        if (ok)
+            memcpy(&value, p, sizeof(value)), p += sizeof(value);
+        return value;
+    }
+};
+
+template <typename T>
+static void PutBytes(vector<unsigned char> &out, T value)
+{
+    unsigned char bytes[sizeof(value)];
+    memcpy(bytes, &value, sizeof(value));
+    out.insert(out.end(), bytes, bytes + sizeof(value));
+}
+
+// Per-map tables carried in globaldata, so later turns and later games on the
+// same map load the base distance maps of the initial brick layout instead of
+// recomputing them. Maps are keyed by a fingerprint of the first request
+// (bricks, steel and water) and the maxMaps most recently played are kept.
+// Only a turn-1 field still has the initial bricks, so that is when a map's
+// entry is written; later turns pass the store on unchanged.
+//
+// The StaticMap tables (passable, rayLength, seesBase) are deliberately not
+// stored: globaldata is not trusted, a bad rayLength would walk off the
+// board, and StaticMap::Get rebuilds them from the masks in a few
+// microseconds. A map whose fingerprint does not match its masks and bricks
+// is dropped along with everything after it.
+//
+// Off by default (BotConfig::mapTables): what is left to store saves a few
+// microseconds per distance map, and only while the bricks are the initial
+// layout, but four maps make a 7-14 KB globaldata string that every turn
+// decodes and re-encodes, about 58 us for 7 KB. Turn it back on only with an
+// end-to-end measurement from ReadInput to the end of the search that shows
+// a gain.
+//
+// Layout: "T2M", version, u8 maps, then per map u64 fingerprint, u64 brick[2],
+// i32 steel[3], i32 water[3], u8 n and n x (u8 side, u8 row, f64 distance[81]).
+class MapTableStore
+{
+    public:
+        static const int version = 3, maxMaps = 4;
+
+        // registers the stored tables; false when globalData holds none of this version
+        bool load(const string &globalData, BaseDistanceCache &cache)
+        {
+            vector<unsigned char> blob;
+            maps.clear();
+            if (!Base64Decode(globalData.c_str(), blob) || blob.size() < 5 ||
+                memcmp(blob.data(), "T2M", 3) || blob[3] != version)
+                return false;
+            ByteReader in(blob.data() + 5, blob.data() + blob.size());
+            // every map read registers a StaticMap for good, so never more than save() writes
+            for (int count = blob[4] < maxMaps ? blob[4] : maxMaps; count > 0; --count)
+            {
+                const unsigned char *begin = in.p;
+                unsigned long long fingerprint = in.read<unsigned long long>();
+                if (!readMap(in, fingerprint, cache))
+                    break;
+                maps.push_back(Entry{ fingerprint, vector<unsigned char>(begin, in.p) });
+            }
+            return !maps.empty();
+        }
+
+        string save(TankGame::TankField *field, BaseDistanceCache &cache)
+        {
+            if (field->currentTurn == 1)
+            {
+                Entry entry;
+                entry.fingerprint = fingerprint(field);
+                writeMap(entry.bytes, field, cache);
+                for (size_t i = 0; i < maps.size(); ++i)
+                    if (maps[i].fingerprint == entry.fingerprint)
+                        maps.erase(maps.begin() + i--);
+                maps.insert(maps.begin(), entry);
+                if ((int)maps.size() > maxMaps)
+                    maps.resize(maxMaps);
+            }
+            if (maps.empty())
+                return "";
+            vector<unsigned char> out = { 'T', '2', 'M', (unsigned char)version, (unsigned char)maps.size() };
+            for (const Entry &entry : maps)
+                out.insert(out.end(), entry.bytes.begin(), entry.bytes.end());
+            return Base64Encode(out.data(), out.size());
+        }
+
+    private:
+        struct Entry
+        {
+            unsigned long long fingerprint;
+            vector<unsigned char> bytes; // the serialized map, fingerprint included
+        };
+        vector<Entry> maps;
+
+        static unsigned long long fingerprint(TankGame::TankField *field)
+        {
+            BaseDistanceCache::Key key = BaseDistanceCache::makeKey(field, 0, 0);
+            return fingerprint(key);
+        }
+        static unsigned long long fingerprint(const BaseDistanceCache::Key &key)
+        {
+            return TankGame::HashMix(TankGame::HashMix(key.terrain->fingerprint ^ key.brick[0]) ^ key.brick[1]);
+        }
+        void writeMap(vector<unsigned char> &out, TankGame::TankField *field, BaseDistanceCache &cache)
+        {
+            const TankGame::StaticMap &terrain = *field->terrain;
+            BaseDistanceCache::Key key = BaseDistanceCache::makeKey(field, 0, 0);
+            PutBytes(out, fingerprint(field));
+            PutBytes(out, key.brick[0]);
+            PutBytes(out, key.brick[1]);
+            for (int i = 0; i < 3; ++i)
+                PutBytes(out, terrain.steelMask[i]);
+            for (int i = 0; i < 3; ++i)
+                PutBytes(out, terrain.waterMask[i]);
+            size_t count = out.size();
+            out.push_back(0);
+            for (int side = 0; side < TankGame::sideCount; ++side)
+                for (int row = 0; row < TankGame::fieldHeight; ++row)
+                    if (const BaseDistanceCache::DistanceMap *dis = cache.find(BaseDistanceCache::makeKey(field, side, row)))
+                    {
+                        ++out[count];
+                        out.push_back((unsigned char)side);
+                        out.push_back((unsigned char)row);
+                        for (int y = 0; y < TankGame::fieldHeight; ++y)
+                            for (int x = 0; x < TankGame::fieldWidth; ++x)
+                                PutBytes(out, (*dis)[y][x]);
+                    }
+        }
+        // one map after its fingerprint: rebuilds the StaticMap and seeds the cache
+        bool readMap(ByteReader &in, unsigned long long fingerprint, BaseDistanceCache &cache)
+        {
+            BaseDistanceCache::Key key = {};
+            int steel[3], water[3];
+            key.brick[0] = in.read<unsigned long long>();
+            key.brick[1] = in.read<unsigned long long>();
+            for (int i = 0; i < 3; ++i)
+                steel[i] = in.read<int>();
+            for (int i = 0; i < 3; ++i)
+                water[i] = in.read<int>();
+            if (!in.ok)
+                return false;
+            key.terrain = TankGame::StaticMap::Get(water, steel);
+            if (MapTableStore::fingerprint(key) != fingerprint)
+                return false;
+            for (int n = in.byte(); n > 0 && in.ok; --n)
+            {
+                key.side = in.byte();
+                key.row = in.byte();
+                BaseDistanceCache::DistanceMap dis;
+                for (int y = 0; y < TankGame::fieldHeight; ++y)
+                    for (int x = 0; x < TankGame::fieldWidth; ++x)
+                        dis[y][x] = in.read<double>();
+                if (in.ok && key.side < TankGame::sideCount && key.row < TankGame::fieldHeight)
+                    cache.put(key, dis);
+            }
+            return in.ok;
+        }
+} mapTables;
+
+// Small policy/value network: three dense layers over 9x9 input planes with
+// int8 weights and uint8 activations, using AVX2 when the CPU has it. It stays
+// disabled until a weight blob is embedded in netWeights.
+//
+// Weight blob (little endian): "T2NN", u32 version = 1, u32 layer count = 3,
+// then per layer u32 inputs, u32 outputs, f32 scale, int8 weights[outputs][inputs
+// rounded up to 32], int32 biases[outputs]. Hidden layers requantize with
+// clamp(round(acc * scale), 0, 127); the last layer outputs acc * scale.
+class PolicyValueNet
+{
+    public:
+        // brick, steel, water, own base, enemy base, 4 tanks, 4 "can shoot", side to move
+        static const int planes = 14;
+        static const int inputs = planes * TankGame::fieldHeight * TankGame::fieldWidth;
+        static const int hidden1 = 128, hidden2 = 64;
+        // logits for own tank 0, own tank 1, enemy tank 0, enemy tank 1 (index act + 1), then value
+        static const int outputs = 4 * 9 + 1;
+
+        bool loaded = false;
+        // skip the AVX2 kernel even where the CPU has it (tools/netcheck)
+        bool scalarOnly = false;
+
+        bool load(const char *base64)
+        {
+            vector<unsigned char> blob;
+            return Base64Decode(base64, blob) && load(blob.data(), blob.size());
+        }
+        bool load(const unsigned char *data, size_t size)
+        {
+            const int dims[3][2] = { { inputs, hidden1 }, { hidden1, hidden2 }, { hidden2, outputs } };
+            size_t pos = 0;
+            auto read = [&](void *dst, size_t n)
+            {
+                if (pos + n > size)
+                    return false;
+                memcpy(dst, data + pos, n);
+                pos += n;
+                return true;
+            };
+            char magic[4];
+            unsigned version, count;
+            loaded = false;
+            if (!read(magic, 4) || memcmp(magic, "T2NN", 4) || !read(&version, 4) || version != 1
+                || !read(&count, 4) || count != 3)
+                return false;
+            for (int l = 0; l < 3; l++)
+            {
+                Layer &layer = layers[l];
+                unsigned in, out;
+                if (!read(&in, 4) || !read(&out, 4) || (int)in != dims[l][0] || (int)out != dims[l][1]
+                    || !read(&layer.scale, 4))
+                    return false;
+                layer.inputs = in;
+                layer.stride = (in + 31) / 32 * 32;
+                layer.outputs = out;
+                layer.weights.assign((size_t)out * layer.stride, 0);
+                layer.bias.resize(out);
+                for (unsigned o = 0; o < out; o++)
+                    if (!read(&layer.weights[(size_t)o * layer.stride], in))
+                        return false;
+                if (!read(layer.bias.data(), 4 * out))
+                    return false;
+            }
+            return loaded = pos == size;
+        }
+
+        // policy[i][act + 1] for own tank 0/1 (i = 0, 1) and enemy tank 0/1 (i = 2, 3)
+        // as seen by Field->mySide; returns the win probability of Field->mySide
+        double evaluate(TankGame::TankField *Field, double policy[4][9])
+        {
+            alignas(32) unsigned char x[(inputs + 31) / 32 * 32] = {};
+            alignas(32) unsigned char h1[hidden1], h2[hidden2];
+            int out[outputs];
+            encode(Field, x);
+            forward(layers[0], x, nullptr, h1);
+            forward(layers[1], h1, nullptr, h2);
+            forward(layers[2], h2, out, nullptr);
+            for (int i = 0; i < 4; i++)
+            {
+                double upper = -std::numeric_limits<double>::max(), sum = 0;
+                for (int a = 0; a < 9; a++)
+                    upper = std::max(upper, out[i * 9 + a] * (double)layers[2].scale);
+                for (int a = 0; a < 9; a++)
+                    sum += policy[i][a] = exp(out[i * 9 + a] * (double)layers[2].scale - upper);
+                for (int a = 0; a < 9; a++)
+                    policy[i][a] /= sum;
+            }
+            return sigmoid(out[outputs - 1] * (double)layers[2].scale);
+        }
+
+    private:
+        struct Layer
+        {
+            int inputs = 0, stride = 0, outputs = 0;
+            float scale = 0;
+            vector<signed char> weights;
+            vector<int> bias;
+        } layers[3];
+
+        void encode(TankGame::TankField *Field, unsigned char *x)
+        {
+            const int cells = TankGame::fieldHeight * TankGame::fieldWidth;
+            int own = Field->mySide;
+            for (int y = 0; y < TankGame::fieldHeight; y++)
+                for (int xx = 0; xx < TankGame::fieldWidth; xx++)
+                {
+                    int c = y * TankGame::fieldWidth + xx;
+                    TankGame::FieldItem item = Field->gameField[y][xx];
+                    x[0 * cells + c] = !!(item & TankGame::Brick);
+                    x[1 * cells + c] = !!(item & TankGame::Steel);
+                    x[2 * cells + c] = !!(item & TankGame::Water);
+                    x[13 * cells + c] = own;
+                }
+            for (int side = 0; side < TankGame::sideCount; side++)
+            {
+                int rel = side == own ? 0 : 1;
+                if (Field->baseAlive[side])
+                    x[(3 + rel) * cells + TankGame::baseY[side] * TankGame::fieldWidth + TankGame::baseX[side]] = 1;
+                for (int tank = 0; tank < TankGame::tankPerSide; tank++)
+                    if (Field->tankAlive[side][tank])
+                    {
+                        int c = Field->tankY[side][tank] * TankGame::fieldWidth + Field->tankX[side][tank];
+                        x[(5 + rel * 2 + tank) * cells + c] = 1;
+                        x[(9 + rel * 2 + tank) * cells + c] =
+                            Field->previousActions[Field->currentTurn - 1][side][tank] <= TankGame::Left;
+                    }
+            }
+        }
+
+        // hidden layers write requantized activations to act, the last one raw sums to raw
+        void forward(const Layer &layer, const unsigned char *in, int *raw, unsigned char *act)
+        {
+            for (int o = 0; o < layer.outputs; o++)
+            {
+                const signed char *w = &layer.weights[(size_t)o * layer.stride];
+                int sum = layer.bias[o] + dot(in, w, layer.stride);
+                if (raw)
+                    raw[o] = sum;
+                else
+                {
+                    long v = lround(sum * (double)layer.scale);
+                    act[o] = (unsigned char)std::min(127L, std::max(0L, v));
+                }
+            }
+        }
+
+        static int dotScalar(const unsigned char *a, const signed char *b, int n)
+        {
+            int sum = 0;
+            for (int i = 0; i < n; i++)
+                sum += a[i] * b[i];
+            return sum;
+        }
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+        // activations are at most 127, so maddubs pairs cannot saturate
+        __attribute__((target("avx2")))
+        static int dotAVX2(const unsigned char *a, const signed char *b, int n)
+        {
+            __m256i acc = _mm256_setzero_si256(), ones = _mm256_set1_epi16(1);
+            for (int i = 0; i < n; i += 32)
+            {
+                __m256i va = _mm256_loadu_si256((const __m256i *)(a + i));
+                __m256i vb = _mm256_loadu_si256((const __m256i *)(b + i));
+                acc = _mm256_add_epi32(acc, _mm256_madd_epi16(_mm256_maddubs_epi16(va, vb), ones));
+            }
+            __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+            sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+            sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+            return _mm_cvtsi128_si32(sum);
+        }
+        int dot(const unsigned char *a, const signed char *b, int n) const
+        {
+            static const bool avx2 = __builtin_cpu_supports("avx2");
+            return avx2 && !scalarOnly ? dotAVX2(a, b, n) : dotScalar(a, b, n);
+        }
+#else
+        int dot(const unsigned char *a, const signed char *b, int n) const
+        {
+            return dotScalar(a, b, n);
+        }
+#endif
+} policyNet;
+
+// base64 of a PolicyValueNet weight blob; empty keeps rollouts and static priors
+const char *netWeights = "";
+
 class VirtualGame
 {
     public:
@@ -1183,7 +2537,7 @@ class VirtualGame
                 // results.push_back(fastJudger.getScore(&Field));
                 if (maxTurns != -1 && Field.currentTurn >= maxTurns + initTurns)
                 {
-                    return sigmoid(fastJudger.getScore(&Field));
+                    return sigmoid(fa->judger->getScore(&Field));
                 }
                 // double lastTime = clock();
                 Action myAction = fa->getAction(&Field);
@@ -1219,6 +2573,8 @@ class MCTSAgent
         int t;
         int maxTurns;
         bool verbose;
+        // score new leaves with the policy network's value instead of a rollout
+        bool useNetValue = true;
         FastAgent fast;
         MCTSAgent() = default;
         MCTSAgent(double s, int t, int ft, int maxTurns,
@@ -1226,71 +2582,196 @@ class MCTSAgent
         : s(s), t(t), fast(ft), maxTurns(maxTurns)
         , verbose(verbose) {} 
         static const int SIMULATION_NUM = 100000;
-        Action getAction(TankGame::TankField *Field)
+        // simulations per trace span
+        static const int simulationBatch = 1024;
+        // a search stops after maxIterations simulations or once the process has
+        // used timeLimit CPU seconds since startClock; 0 is the process start, so
+        // the per-turn budget also covers reading the input
+        int maxIterations = SIMULATION_NUM;
+        double timeLimit = 0.9;
+        clock_t startClock = 0;
+        // Memory budget of the search tree, counted with treeBytes. Once the
+        // tree holds that much, new leaves are still evaluated and backed up
+        // but not kept, so a keep-running game, which also carries the last
+        // turn's subtree, stays under Botzone's 256 MB.
+        static const size_t defaultTreeBudget = (size_t)160 << 20;
+        size_t treeBudget = defaultTreeBudget;
+
+        // Counters of the last search. Phase times come from the steady clock
+        // read at the phase boundaries of every simulation.
+        struct SearchStats
         {
-            MCTnode root = MCTnode(Field, s, t);
-            long long startTime = 0;
-            int it;
-            for (it = 0; it < SIMULATION_NUM; ++it)
+            static const int rolloutBuckets = 8; // rollout turns, the last bucket is 7+
+            int simulations = 0;
+            size_t nodes = 0, bytes = 0;
+            size_t reused = 0; // nodes kept from the previous turn's tree
+            size_t budget = 0; // treeBudget of the search
+            long long unkept = 0; // leaves evaluated after the tree reached the budget
+            int maxDepth = 0;
+            long long depthSum = 0;
+            long long rollouts[rolloutBuckets] = {};
+            long long evalProbes = 0, evalHits = 0;
+            double selectMs = 0, expandMs = 0, rolloutMs = 0, backpropMs = 0, totalMs = 0;
+            double replayMs = 0; // history replay before the search, set by main
+
+            double avgDepth() const { return simulations ? 1. * depthSum / simulations : 0; }
+            double evalHitRate() const { return evalProbes ? 1. * evalHits / evalProbes : 0; }
+
+            // one line for the Botzone debug field
+            string compact() const
+            {
+                std::ostringstream out;
+                out.precision(3);
+                out << "sims " << simulations << " nodes " << nodes << " reused " << reused << " mem " << (bytes >> 10) << "K/" << (budget >> 20) << "M unkept " << unkept << " depth "
+                    << maxDepth << "/" << avgDepth() << " roll";
+                for (int i = 0; i < rolloutBuckets; i++)
+                    out << (i ? "," : " ") << rollouts[i];
+                out << " ec " << evalHitRate() * 100 << "% ms sel " << selectMs << " exp " << expandMs
+                    << " roll " << rolloutMs << " bp " << backpropMs << " all " << totalMs << " replay " << replayMs;
+                return out.str();
+            }
+            // one JSON object per turn for the local stats file
+            string json(int turn) const
             {
-                double second = (double) (clock() - startTime)/ CLOCKS_PER_SEC;
-                if (second > 0.9)
+                std::ostringstream out;
+                out << "{\"turn\":" << turn << ",\"simulations\":" << simulations << ",\"nodes\":" << nodes
+                    << ",\"reused\":" << reused << ",\"bytes\":" << bytes << ",\"budget\":" << budget << ",\"unkept\":" << unkept << ",\"max_depth\":" << maxDepth << ",\"avg_depth\":" << avgDepth()
+                    << ",\"rollout_lengths\":[";
+                for (int i = 0; i < rolloutBuckets; i++)
+                    out << (i ? "," : "") << rollouts[i];
+                out << "],\"eval_cache_hit_rate\":" << evalHitRate() << ",\"select_ms\":" << selectMs
+                    << ",\"expand_ms\":" << expandMs << ",\"rollout_ms\":" << rolloutMs
+                    << ",\"backprop_ms\":" << backpropMs << ",\"total_ms\":" << totalMs
+                    << ",\"replay_ms\":" << replayMs << "}";
+                return out.str();
+            }
+        };
+        SearchStats stats;
+
+        // visit and win statistics of both sides at the root of one search
+        struct RootStats
+        {
+            int iterations;
+            vector<Action> moves[2];
+            vector<double> visits[2], wins[2];
+        };
+        RootStats search(TankGame::TankField *Field)
+        {
+            MCTnode &root = newRoot(Field);
+            RootStats stats;
+            stats.iterations = runSearch(root);
+            for (int side = 0; side < 2; ++side)
+                if (root.result == -1)
+                {
+                    stats.moves[side] = root.actionAgent[side].validMove;
+                    stats.visits[side] = root.actionAgent[side].visitSum;
+                    stats.wins[side] = root.actionAgent[side].winSum;
+                }
+            return stats;
+        }
+        ~MCTSAgent()
+        {
+            clearPool();
+        }
+
+        // Warm start across turns through the Botzone data field. After a search,
+        // saveSummary keeps the subtrees below our move for the opponent's most
+        // visited replies (stats of summaryMoves moves per side, summaryChildren
+        // children per node, summaryDepth levels), base64 within maxChars.
+        // loadSummary stores it and the next root grafts the subtree of the
+        // reply that was played, with the counts scaled by summaryWeight.
+        //
+        // Layout: "T2S", version, u16 turn, u8 side, i8 move[2], u8 entries,
+        // then per entry i8 reply[2] and a node: f32 visits, f32 wins, per side
+        // u8 n and n x (i8 move[2], f32 visits, f32 wins), u8 children and per
+        // child u8 index0, u8 index1 and its node.
+        static const int summaryVersion = 1;
+        static const size_t summaryHeader = 10; // bytes before the first entry
+        int summaryReplies = 4, summaryMoves = 12, summaryChildren = 6, summaryDepth = 1;
+        double summaryMinVisits = 8, summaryWeight = 0.5;
+        string saveSummary(Action played, size_t maxChars = 16384)
+        {
+            if (!root || root->result != -1)
+                return "";
+            int side = root->Field.mySide;
+            int mine = findMove(root->actionAgent[side], played[0], played[1]);
+            if (mine < 0)
+                return "";
+            vector<unsigned char> out = { 'T', '2', 'S', (unsigned char)summaryVersion,
+                (unsigned char)(root->Field.currentTurn & 0xFF), (unsigned char)(root->Field.currentTurn >> 8),
+                (unsigned char)side, (unsigned char)played[0], (unsigned char)played[1], 0 };
+            const ActionAgent &enemy = root->actionAgent[1 - side];
+            for (int reply : topIndices(enemy.visitSum, summaryReplies))
+            {
+                int hashID = side == 0 ? mine * enemy.actionNum + reply
+                    : reply * root->actionAgent[1].actionNum + mine;
+                auto it = root->nxt.find(hashID);
+                if (it == root->nxt.end())
+                    continue;
+                size_t size = out.size();
+                out.push_back((unsigned char)enemy.validMove[reply].a[0]);
+                out.push_back((unsigned char)enemy.validMove[reply].a[1]);
+                writeNode(out, it->second, summaryDepth);
+                if ((out.size() + 2) / 3 * 4 > maxChars)
+                {
+                    out.resize(size);
                     break;
-                simulate(&root);
+                }
+                ++out[9];
             }
+            return Base64Encode(out.data(), out.size());
+        }
+        // false when data is not a summary of this version
+        bool loadSummary(const string &data)
+        {
+            summary.clear();
+            if (!Base64Decode(data.c_str(), summary) || summary.size() < summaryHeader ||
+                memcmp(summary.data(), "T2S", 3) || summary[3] != summaryVersion)
+            {
+                summary.clear();
+                return false;
+            }
+            return true;
+        }
+        Action getAction(TankGame::TankField *Field)
+        {
+            MCTnode &root = newRoot(Field);
+            runSearch(root);
             int action = 0;
             for (int i=0; i<root.actionAgent[Field->mySide].actionNum; ++i)
             {
 
                 if (verbose)
-                {
-                    debug << i <<": " << root.actionAgent[Field->mySide].validMove[i]
-                        << " " <<  root.actionAgent[Field->mySide].winSum[i] 
-                        <<'/' << root.actionAgent[Field->mySide].visitSum[i] << "="
-                        << 1. * root.actionAgent[Field->mySide].winSum[i]/root.actionAgent[Field->mySide].visitSum[i] << endl;
-                }
+                    TRACE(RootAction, i, root.actionAgent[Field->mySide].validMove[i][0],
+                        root.actionAgent[Field->mySide].validMove[i][1],
+                        root.actionAgent[Field->mySide].winSum[i], root.actionAgent[Field->mySide].visitSum[i]);
                 if (root.actionAgent[Field->mySide].visitSum[i]
                 > root.actionAgent[Field->mySide].visitSum[action])
                     action = i;
             }
 
-            debug << it << ' ';
-            debug << action << ' ';
-            debug << root.actionAgent[Field->mySide].actionNum << ' ';
-            if (verbose)
-            {
-                debug << root.actionAgent[Field->mySide].winSum[action] 
-                <<'/' << root.actionAgent[Field->mySide].visitSum[action] << "="
-                << 1. * root.actionAgent[Field->mySide].winSum[action]/root.actionAgent[Field->mySide].visitSum[action] << endl;
-            }
+            TRACE(SearchDone, stats.simulations, action, root.actionAgent[Field->mySide].actionNum,
+                root.actionAgent[Field->mySide].winSum[action], root.actionAgent[Field->mySide].visitSum[action]);
             Action bestAction(root.actionAgent[Field->mySide].validMove[action]);
             return bestAction;
         } 
         std::vector< std::pair<Action, std::pair<double,double> > > getActions(TankGame::TankField *Field)
         {
-            MCTnode root = MCTnode(Field, s, t);
-            long long startTime = 0;
-            int it;
-            for (it = 0; it < SIMULATION_NUM; ++it)
-            {
-                double second = (double) (clock() - startTime)/ CLOCKS_PER_SEC;
-                if (second > 0.9)
-                    break;
-                simulate(&root);
-            }
+            MCTnode &root = newRoot(Field);
+            runSearch(root);
             std::vector<std::pair<int,double> > actions;
             for (int i=0; i<root.actionAgent[Field->mySide].actionNum; ++i)
             {
 
                 if (verbose)
-                {
-                    debug << i <<": " << root.actionAgent[Field->mySide].validMove[i]
-                        << " " <<  root.actionAgent[Field->mySide].winSum[i] 
-                        <<'/' << root.actionAgent[Field->mySide].visitSum[i] << "="
-                        << 1. * root.actionAgent[Field->mySide].winSum[i]/root.actionAgent[Field->mySide].visitSum[i] << endl;
-                }
+                    TRACE(RootAction, i, root.actionAgent[Field->mySide].validMove[i][0],
+                        root.actionAgent[Field->mySide].validMove[i][1],
+                        root.actionAgent[Field->mySide].winSum[i], root.actionAgent[Field->mySide].visitSum[i]);
                 actions.push_back(std::pair<int,int>(i, root.actionAgent[Field->mySide].visitSum[i]));
             }
+            if (verbose)
+                TRACE(EvalCacheStats, fastJudger.evalCache.bytes() >> 20, 0, 0,
+                    fastJudger.evalCache.hits, fastJudger.evalCache.probes);
             sort(actions.begin(), actions.end(), [](const std::pair<int,int> &pa, const std::pair<int, int> &pb)
             {
                 return pa.second > pb.second;
@@ -1305,7 +2786,7 @@ class MCTSAgent
             return returnVal;
        } 
  
-    private:
+        // per-side statistics of a node; public so tools/bench can time getBest
         struct ActionAgent
         {
             int actionNum;
@@ -1313,17 +2794,24 @@ class MCTSAgent
             vector<double> prior;
             vector<Action> validMove;
             ActionAgent() = default;
-            ActionAgent(TankGame::TankField *Field, double s, int t)
+            // netPolicy holds the network's distributions for the two tanks of
+            // Field->mySide; without it priors come from the static scores
+            ActionAgent(TankGame::TankField *Field, double s, int t, const double (*netPolicy)[9] = nullptr)
             {
                 auto actionRank = fastJudger.getBestBlocks(Field, t);
                 double upper = actionRank.front().second;
+                for (auto &p : actionRank)
+                    upper = std::max(upper, p.second);
                 validMove.reserve(actionRank.size());
                 prior.reserve(actionRank.size());
                 double sum = 0;
                 for (auto &p : actionRank)
                 {
                     validMove.push_back(p.first);
-                    prior.push_back(exp((p.second-upper)*s));
+                    if (netPolicy)
+                        prior.push_back(netPolicy[0][p.first[0] + 1] * netPolicy[1][p.first[1] + 1]);
+                    else
+                        prior.push_back(exp((p.second-upper)*s));
                     sum += prior.back();
                 }
                 for (auto &p : prior)
@@ -1357,18 +2845,22 @@ class MCTSAgent
                 return possibles.empty() ? -1 : possibles[rand()%possibles.size()];
             }
         };
+        // a search tree node; public, like the helpers below, so tools/summarycheck
+        // can compare a grafted tree with the one it was saved from
         struct MCTnode
         {
             double result;
             double visitCount;
             double winCount;
+            // network value of this position for Field.mySide, -1 without a network
+            double netValue = -1;
             TankGame::TankField Field;
             ActionAgent actionAgent[2];
             std::unordered_map<int, MCTnode *> nxt;
             MCTnode() {}
             MCTnode(TankGame::TankField *field, double s, int t)
             {
-                
+                visitCount = winCount = 0;
                 TankGame::GameResult res = field->GetGameResult();
                 if (res == TankGame::NotFinished) {
                     result = -1;
@@ -1381,20 +2873,46 @@ class MCTSAgent
                     else result = 0.5;
                     return;
                 }
-            
-                visitCount = winCount = 0;
+
                 Field = *field;
-                actionAgent[Field.mySide] = ActionAgent(&Field, s, t);
+                double policy[4][9];
+                if (policyNet.loaded)
+                    netValue = policyNet.evaluate(&Field, policy);
+                actionAgent[Field.mySide] = ActionAgent(&Field, s, t, policyNet.loaded ? policy : nullptr);
                 Field.mySide ^= 1;
-                actionAgent[Field.mySide] = ActionAgent(&Field, s, t);
+                actionAgent[Field.mySide] = ActionAgent(&Field, s, t, policyNet.loaded ? policy + 2 : nullptr);
                 Field.mySide ^= 1;
             }
         };
+        // the root of the last search, null before the first
+        const MCTnode *searchRoot() const { return root; }
+        static int findMove(const ActionAgent &agent, int a0, int a1)
+        {
+            for (int i = 0; i < agent.actionNum; ++i)
+                if (agent.validMove[i].a[0] == a0 && agent.validMove[i].a[1] == a1)
+                    return i;
+            return -1;
+        }
+        // indices of the most visited entries of values, at most limit of them
+        static vector<int> topIndices(const vector<double> &values, int limit)
+        {
+            vector<int> order;
+            for (int i = 0; i < (int)values.size(); ++i)
+                if (values[i] > 0)
+                    order.push_back(i);
+            std::sort(order.begin(), order.end(), [&](int a, int b) { return values[a] > values[b]; });
+            if ((int)order.size() > limit)
+                order.resize(limit);
+            return order;
+        }
+    private:
         void simulate(MCTnode *pNode)
         {
             static MCTnode *pNodeStk[110];
             static int action0Stk[110];
             static int action1Stk[110];
+            typedef std::chrono::steady_clock Clock;
+            Clock::time_point phaseStart = Clock::now();
             int cnt = 0;
             double result;
             while (true)
@@ -1405,6 +2923,9 @@ class MCTSAgent
                     pNode->visitCount += 1;
                     pNode->winCount += pNode->result;
                     result = pNode->result;
+                    Clock::time_point selectEnd = Clock::now();
+                    stats.selectMs += std::chrono::duration<double, std::milli>(selectEnd - phaseStart).count();
+                    phaseStart = selectEnd;
                     break;
                 }
                 int action0 = pNode->actionAgent[0].getBest(pNode->visitCount);
@@ -1421,6 +2942,8 @@ class MCTSAgent
                 auto it = pNode->nxt.find(hashID);
                 double winValue = 0;
                 if (it == pNode->nxt.end()) {
+                    Clock::time_point expandStart = Clock::now();
+                    stats.selectMs += std::chrono::duration<double, std::milli>(expandStart - phaseStart).count();
                     TankGame::TankField nxtfield = pNode->Field;
                     nxtfield.nextAction[0][0] = pNode->actionAgent[0].validMove[action0][0];
                     nxtfield.nextAction[0][1] = pNode->actionAgent[0].validMove[action0][1];
@@ -1431,19 +2954,43 @@ class MCTSAgent
 
                     if (nxtfield.DoAction() == 0)
                         throw std::runtime_error("(stimulate)the best is invalid");
-                    Pool.emplace_back(new MCTnode(&nxtfield, s, t));
-                    pNode->nxt[hashID] = Pool.back();
-                    winValue = VirtualGame(&nxtfield).run(&fast, maxTurns);
-                    ++ Pool.back() -> visitCount;
-                    Pool.back()->winCount += winValue;
+                    std::unique_ptr<MCTnode> leaf(new MCTnode(&nxtfield, s, t));
+                    if (poolBytes < treeBudget)
+                    {
+                        poolBytes += treeBytes(*leaf) + childEntryBytes;
+                        Pool.push_back(leaf.get());
+                        pNode->nxt[hashID] = leaf.release();
+                    }
+                    else
+                        ++stats.unkept;
+                    MCTnode *node = leaf ? leaf.get() : Pool.back();
+                    phaseStart = Clock::now();
+                    stats.expandMs += std::chrono::duration<double, std::milli>(phaseStart - expandStart).count();
+                    if (useNetValue && node->netValue >= 0)
+                        winValue = node->netValue;
+                    else
+                    {
+                        VirtualGame game(&nxtfield);
+                        winValue = game.run(&fast, maxTurns);
+                        int length = game.Field.currentTurn - game.initTurns;
+                        ++stats.rollouts[std::min(length, SearchStats::rolloutBuckets - 1)];
+                        Clock::time_point rolloutEnd = Clock::now();
+                        stats.rolloutMs += std::chrono::duration<double, std::milli>(rolloutEnd - phaseStart).count();
+                        phaseStart = rolloutEnd;
+                    }
+                    ++node->visitCount;
+                    node->winCount += winValue;
                     result = winValue;
                     break;
                 }
                 else pNode = it->second;
             }
             // if (verbose) debug << endl; 
+            stats.maxDepth = std::max(stats.maxDepth, cnt);
+            stats.depthSum += cnt;
             for (int i=0; i<cnt; ++i)
                 backPropagation(pNodeStk[i], action0Stk[i], action1Stk[i], result);
+            stats.backpropMs += std::chrono::duration<double, std::milli>(Clock::now() - phaseStart).count();
         }
         void backPropagation(MCTnode *pNode, int action0, int action1, double winValue) {
             int side = pNode->Field.mySide;
@@ -1454,41 +3001,416 @@ class MCTSAgent
             ++pNode ->actionAgent[1].visitSum[action1];
             pNode ->actionAgent[1].winSum[action1] += side==1?winValue:1-winValue; 
         }
+        // the previous tree's node for Field when there is one (the agent lives
+        // across turns), otherwise a fresh root, grafted from a loaded summary
+        // when it matches; the rest of the previous tree is freed
+        MCTnode &newRoot(TankGame::TankField *Field)
+        {
+            TRACE_SPAN(BuildRoot);
+            if (MCTnode *next = reusableChild(Field))
+            {
+                keepSubtree(next);
+                return *root;
+            }
+            clearPool();
+            root = new MCTnode(Field, s, t);
+            Pool.push_back(root);
+            poolBytes = treeBytes(*root);
+            graftSummary();
+            return *root;
+        }
+        // the child of root reached by the joint action that led to Field
+        MCTnode *reusableChild(TankGame::TankField *Field)
+        {
+            if (!root || root->result != -1 || root->Field.mySide != Field->mySide ||
+                root->Field.currentTurn + 1 != Field->currentTurn)
+                return nullptr;
+            const TankGame::Action (*played)[TankGame::tankPerSide] = Field->previousActions[Field->currentTurn - 1];
+            int i0 = findMove(root->actionAgent[0], played[0][0], played[0][1]);
+            int i1 = findMove(root->actionAgent[1], played[1][0], played[1][1]);
+            if (i0 < 0 || i1 < 0)
+                return nullptr;
+            auto it = root->nxt.find(i0 * root->actionAgent[1].actionNum + i1);
+            if (it == root->nxt.end() || it->second->Field.Hash() != Field->Hash())
+                return nullptr;
+            return it->second;
+        }
+        void keepSubtree(MCTnode *next)
+        {
+            vector<MCTnode *> kept(1, next);
+            for (size_t i = 0; i < kept.size(); ++i)
+                for (auto &child : kept[i]->nxt)
+                    kept.push_back(child.second);
+            vector<MCTnode *> sorted = kept;
+            std::sort(sorted.begin(), sorted.end());
+            for (MCTnode *node : Pool)
+                if (!std::binary_search(sorted.begin(), sorted.end(), node))
+                    delete node;
+            Pool.swap(kept);
+            poolBytes = 0;
+            for (MCTnode *node : Pool)
+                poolBytes += treeBytes(*node);
+            root = next;
+            summary.clear();
+        }
+        int runSearch(MCTnode &root)
+        {
+            stats = SearchStats();
+            stats.reused = Pool.size() - 1;
+            stats.budget = treeBudget;
+            long long probes = fastJudger.evalCache.probes, hits = fastJudger.evalCache.hits;
+            auto start = std::chrono::steady_clock::now();
+            int it;
+            for (it = 0; it < maxIterations; ++it)
+            {
+                double second = (double) (clock() - startClock)/ CLOCKS_PER_SEC;
+                if (second > timeLimit)
+                    break;
+                if (it % simulationBatch == 0)
+                {
+                    if (it)
+                        TRACE_END(SimulationBatch);
+                    TRACE_BEGIN(SimulationBatch);
+                }
+                simulate(&root);
+            }
+            if (it)
+                TRACE_END(SimulationBatch);
+            stats.simulations = it;
+            stats.nodes = Pool.size();
+            stats.bytes = 0;
+            for (MCTnode *node : Pool)
+                stats.bytes += treeBytes(*node);
+            poolBytes = stats.bytes;
+            stats.evalProbes = fastJudger.evalCache.probes - probes;
+            stats.evalHits = fastJudger.evalCache.hits - hits;
+            stats.totalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            return it;
+        }
+        // estimated hash table node of one child in its parent's nxt
+        static const size_t childEntryBytes = sizeof(std::pair<const int, MCTnode *>) + 2 * sizeof(void *);
+        // heap and inline memory of one node, hash table nodes estimated
+        static size_t treeBytes(const MCTnode &node)
+        {
+            size_t bytes = sizeof(MCTnode) + node.nxt.bucket_count() * sizeof(void *)
+                + node.nxt.size() * childEntryBytes;
+            for (const ActionAgent &agent : node.actionAgent)
+                bytes += (agent.visitSum.capacity() + agent.winSum.capacity() + agent.prior.capacity()) * sizeof(double)
+                    + agent.validMove.capacity() * sizeof(Action);
+            return bytes;
+        }
+        // nodes of the previous search
+        void clearPool()
+        {
+            for (MCTnode *node : Pool)
+                delete node;
+            Pool.clear();
+            poolBytes = 0;
+        }
         std::vector<MCTnode *> Pool;
+        MCTnode *root = nullptr;
+        // treeBytes of Pool: exact after each search and after keepSubtree,
+        // grown by an estimate per node in between
+        size_t poolBytes = 0;
+        vector<unsigned char> summary;
+
+        void writeNode(vector<unsigned char> &out, MCTnode *node, int depth)
+        {
+            PutBytes(out, (float)node->visitCount);
+            PutBytes(out, (float)node->winCount);
+            vector<int> kept[2];
+            for (int side = 0; side < 2; ++side)
+            {
+                const ActionAgent &agent = node->actionAgent[side];
+                kept[side] = node->result == -1 ? topIndices(agent.visitSum, summaryMoves) : vector<int>();
+                out.push_back((unsigned char)kept[side].size());
+                for (int i : kept[side])
+                {
+                    out.push_back((unsigned char)agent.validMove[i].a[0]);
+                    out.push_back((unsigned char)agent.validMove[i].a[1]);
+                    PutBytes(out, (float)agent.visitSum[i]);
+                    PutBytes(out, (float)agent.winSum[i]);
+                }
+            }
+            vector<std::pair<double, std::pair<int, int> > > children;
+            for (int i = 0; i < (int)kept[0].size() && depth > 0; ++i)
+                for (int j = 0; j < (int)kept[1].size(); ++j)
+                {
+                    auto it = node->nxt.find(kept[0][i] * node->actionAgent[1].actionNum + kept[1][j]);
+                    if (it != node->nxt.end() && it->second->visitCount >= summaryMinVisits)
+                        children.push_back(std::make_pair(it->second->visitCount, std::make_pair(i, j)));
+                }
+            std::sort(children.begin(), children.end(), std::greater<std::pair<double, std::pair<int, int> > >());
+            if ((int)children.size() > summaryChildren)
+                children.resize(summaryChildren);
+            out.push_back((unsigned char)children.size());
+            for (auto &child : children)
+            {
+                int i = child.second.first, j = child.second.second;
+                out.push_back((unsigned char)i);
+                out.push_back((unsigned char)j);
+                writeNode(out, node->nxt[kept[0][i] * node->actionAgent[1].actionNum + kept[1][j]], depth - 1);
+            }
+        }
+        // reads one node into node, or only skips it when node is null; like
+        // writeNode, a node at depth 0 has no children, so the recursion (and
+        // the DoAction and allocation per level) stops at summaryDepth whatever
+        // the blob says
+        void readNode(ByteReader &in, MCTnode *node, int depth)
+        {
+            double visits = in.read<float>(), wins = in.read<float>();
+            if (node)
+                node->visitCount = visits * summaryWeight, node->winCount = wins * summaryWeight;
+            vector<int> index[2];
+            for (int side = 0; side < 2; ++side)
+            {
+                int n = in.byte();
+                for (int k = 0; k < n && in.ok; ++k)
+                {
+                    int a0 = (signed char)in.byte(), a1 = (signed char)in.byte();
+                    double v = in.read<float>(), w = in.read<float>();
+                    int i = node && node->result == -1 ? findMove(node->actionAgent[side], a0, a1) : -1;
+                    index[side].push_back(i);
+                    if (i >= 0)
+                    {
+                        node->actionAgent[side].visitSum[i] = v * summaryWeight;
+                        node->actionAgent[side].winSum[i] = w * summaryWeight;
+                    }
+                }
+            }
+            int children = in.byte();
+            if (children > 0 && depth <= 0)
+            {
+                in.ok = false;
+                return;
+            }
+            for (int c = 0; c < children && in.ok; ++c)
+            {
+                int i = in.byte(), j = in.byte();
+                if (i >= (int)index[0].size() || j >= (int)index[1].size())
+                {
+                    in.ok = false;
+                    return;
+                }
+                MCTnode *child = nullptr;
+                if (node && index[0][i] >= 0 && index[1][j] >= 0)
+                {
+                    TankGame::TankField field = node->Field;
+                    for (int tank = 0; tank < 2; ++tank)
+                    {
+                        field.nextAction[0][tank] = node->actionAgent[0].validMove[index[0][i]][tank];
+                        field.nextAction[1][tank] = node->actionAgent[1].validMove[index[1][j]][tank];
+                    }
+                    if (field.DoAction())
+                    {
+                        child = new MCTnode(&field, s, t);
+                        Pool.push_back(child);
+                        poolBytes += treeBytes(*child) + childEntryBytes;
+                        node->nxt[index[0][i] * node->actionAgent[1].actionNum + index[1][j]] = child;
+                    }
+                }
+                readNode(in, child, depth - 1);
+            }
+        }
+        // applies the subtree saved for the moves that led to root
+        void graftSummary()
+        {
+            if (summary.size() < summaryHeader || root->result != -1)
+                return;
+            TankGame::TankField &field = root->Field;
+            int side = field.mySide, turn = summary[4] | summary[5] << 8;
+            const TankGame::Action *played = field.previousActions[field.currentTurn - 1][side];
+            const TankGame::Action *replied = field.previousActions[field.currentTurn - 1][1 - side];
+            if (turn + 1 != field.currentTurn || summary[6] != side ||
+                (signed char)summary[7] != played[0] || (signed char)summary[8] != played[1])
+                return;
+            ByteReader in(summary.data() + summaryHeader, summary.data() + summary.size());
+            for (int entries = summary[summaryHeader - 1]; entries > 0 && in.ok; --entries)
+            {
+                int a0 = (signed char)in.byte(), a1 = (signed char)in.byte();
+                ByteReader check = in;
+                readNode(check, nullptr, summaryDepth);
+                if (!check.ok)
+                    break;
+                if (a0 == replied[0] && a1 == replied[1])
+                {
+                    readNode(in, root, summaryDepth);
+                    break;
+                }
+                in = check;
+            }
+            summary.clear();
+        }
 };
 
 void debugPrint(std::vector<std::pair<Action,std::pair<double,double> > > actions)
 {
+#ifdef TANK2_TRACE
     for (auto x:actions)
-        debug << x.first << ": " << x.second.first << "/" << x.second.second <<
-            " : " << x.second.first/x.second.second << endl;
+        TRACE(Candidate, x.first[0], x.first[1], 0, x.second.first, x.second.second);
+#else
+    (void)actions;
+#endif
 }
 Action chooseAction(std::vector<std::pair<Action,std::pair<double,double> > > actions)
 {
-
+    // getActions sorts by visit count
+    return actions.front().first;
 }
 
-int main()
+// Search settings. Botzone runs the defaults; local matches (tools/arena,
+// tools/sprt) pit variants against each other with "--name value" arguments,
+// e.g. "bot --s 0.1 --time 0.45"
+struct BotConfig
+{
+    double s = 0.05;
+    int t = 81, ft = 81, maxTurns = 5;
+    double timeLimit = 0.9;
+    int maxIterations = MCTSAgent::SIMULATION_NUM;
+    int netValue = 1;
+    int summary = 1; // warm start from the previous turn's tree through data
+    int mapTables = 0; // per-map tables through globaldata, see MapTableStore
+    int evalCacheMb = Judger::defaultEvalCacheBytes >> 20; // 0 turns the getScore cache off
+    int treeMb = MCTSAgent::defaultTreeBudget >> 20; // search tree budget, see MCTSAgent::treeBudget
+    // stay alive between turns (Botzone "allow long-running"); the bot must be
+    // uploaded with that option, so it is off unless built with TANK2_KEEP_RUNNING
+#ifdef TANK2_KEEP_RUNNING
+    int keepRunning = 1;
+#else
+    int keepRunning = 0;
+#endif
+    string params; // JudgerParams block replacing judgerParamBlock
+
+    // false on an unknown name or a missing value
+    bool parse(int argc, char **argv)
+    {
+        for (int i = 1; i < argc; i += 2)
+        {
+            if (i + 1 >= argc || strncmp(argv[i], "--", 2))
+                return false;
+            string name = argv[i] + 2;
+            const char *value = argv[i + 1];
+            if (name == "s")
+                s = atof(value);
+            else if (name == "t")
+                t = atoi(value);
+            else if (name == "ft")
+                ft = atoi(value);
+            else if (name == "turns")
+                maxTurns = atoi(value);
+            else if (name == "time")
+                timeLimit = atof(value);
+            else if (name == "iters")
+                maxIterations = atoi(value);
+            else if (name == "net-value")
+                netValue = atoi(value);
+            else if (name == "summary")
+                summary = atoi(value);
+            else if (name == "map-tables")
+                mapTables = atoi(value);
+            else if (name == "eval-cache-mb")
+                evalCacheMb = atoi(value);
+            else if (name == "tree-mb")
+                treeMb = atoi(value);
+            else if (name == "keep-running")
+                keepRunning = atoi(value);
+            else if (name == "params")
+                params = value;
+            else
+                return false;
+        }
+        return true;
+    }
+
+    MCTSAgent *makeAgent() const
+    {
+        MCTSAgent *agent = new MCTSAgent(s, t, ft, maxTurns, 1);
+        agent->timeLimit = timeLimit;
+        agent->maxIterations = maxIterations;
+        agent->useNetValue = netValue != 0;
+        agent->treeBudget = (size_t)treeMb << 20;
+        return agent;
+    }
+};
+
+#ifndef TANK2_NO_MAIN
+int main(int argc, char **argv)
 {
     // cout << 1 << endl;
+#ifndef _BOTZONE_ONLINE
     freopen("in.txt", "r", stdin);
     freopen("out.txt", "w", stdout);
+#endif
     srand((unsigned)time(nullptr));
+    BotConfig config;
+    if (!config.parse(argc, argv))
+    {
+        std::cerr << "usage: " << argv[0] << " [--s 0.05] [--t 81] [--ft 81] [--turns 5] [--time 0.9]"
+            " [--iters N] [--net-value 1] [--summary 1] [--map-tables 0] [--eval-cache-mb 0] [--tree-mb 160] [--keep-running 0]"
+            " [--params \"name=value ...\"]" << endl;
+        return 1;
+    }
+    if ((size_t)config.evalCacheMb << 20 != Judger::defaultEvalCacheBytes)
+        fastJudger.evalCache.resize((size_t)std::max(0, config.evalCacheMb) << 20);
+    if (*judgerParamBlock && !fastJudger.params.load(judgerParamBlock))
+    {
+        std::cerr << "bad judgerParamBlock" << endl;
+        return 1;
+    }
+    if (!config.params.empty() && !fastJudger.params.load(config.params))
+    {
+        std::cerr << "bad --params block" << endl;
+        return 1;
+    }
+    if (*netWeights)
+        policyNet.load(netWeights);
 
+    if (config.mapTables)
+        TankGame::globalDataLoader = [](const string &globalData) { mapTables.load(globalData, fastJudger.baseDistance); };
     string data, globaldata;
     TankGame::ReadInput(cin, data, globaldata);
-    MCTSAgent *Agent = new MCTSAgent(0.05, 81, 81, 5, 1);
-    // Action action = Agent->getAction(TankGame::field);
-    std::vector<std::pair<Action, std::pair<double,double> > > actions = Agent->getActions(TankGame::field);
-    debugPrint(actions);
-    Action action = chooseAction(actions);
-    TankGame::SubmitAndExit(action[0], action[1]);
+    MCTSAgent *Agent = config.makeAgent();
+    if (config.summary)
+        Agent->loadSummary(data);
+    // In keep-running mode the judge sends only the opponent's move after the
+    // first turn; ReadInput applies it to the field left by SubmitAndDontExit,
+    // and the agent keeps its subtree and the judger its caches
+    while (true)
+    {
+        // Action action = Agent->getAction(TankGame::field);
+        std::vector<std::pair<Action, std::pair<double,double> > > actions = Agent->getActions(TankGame::field);
+        debugPrint(actions);
+        Action action = chooseAction(actions);
+        Agent->stats.replayMs = TankGame::replayMicroseconds / 1000;
+#ifndef _BOTZONE_ONLINE
+        std::ofstream("search_stats.jsonl", std::ios::app) << Agent->stats.json(TankGame::field->currentTurn) << endl;
+#endif
+        {
+            TRACE_SPAN(WriteOutput);
+            string globalData = config.mapTables ? mapTables.save(TankGame::field, fastJudger.baseDistance) : "";
+            if (config.keepRunning)
+                TankGame::SubmitAndDontExit(action[0], action[1], Agent->stats.compact(), "", globalData);
+            else
+                // SubmitAndExit without the exit, so the output span is drained too
+                TankGame::Internals::_submitAction(action[0], action[1], Agent->stats.compact(),
+                    config.summary ? Agent->saveSummary(action) : "", globalData);
+        }
+        TRACE_DRAIN();
+        // the judge closes the input (or kills the bot) once the game is over
+        if (!config.keepRunning || !(cin >> std::ws) || cin.peek() == EOF)
+            break;
+        TankGame::ReadInput(cin, data, globaldata);
+        // clock() keeps counting across turns; the budget starts with the input
+        Agent->startClock = clock();
+    }
+    exit(0);
     // TankGame::field->DebugPrint();
     // Greedy GreedyBot(TankGame::field);
     // std::pair<TankGame::Action, TankGame::Action> ret = GreedyBot.getAction(5);
     // TankGame::SubmitAndExit(ret.first, ret.second);
     // TankGame::SubmitAndExit(RandAction(0), RandAction(1));
 }
+#endif
 
 
 
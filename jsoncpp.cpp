@@ -1037,6 +1037,584 @@ std::istream& operator>>(std::istream& sin, Value& root) {
 
 
 
+// //////////////////////////////////////////////////////////////////////
+// Beginning of content of file: src/lib_json/json_event_reader.cpp
+// //////////////////////////////////////////////////////////////////////
+
+// Streaming counterpart of json_reader.cpp, declared in jsoncpp/json_ext.h.
+// The tokenizer and the number and string decoding follow Reader.
+
+#include "jsoncpp/json_ext.h"
+
+namespace Json {
+
+// Class EventReader
+// //////////////////////////////////////////////////////////////////
+
+EventReader::EventReader()
+    : features_(Features::all()), begin_(), end_(), current_(), stack_(),
+      scratch_(), error_(), errorLocation_() {}
+
+EventReader::EventReader(const Features& features)
+    : features_(features), begin_(), end_(), current_(), stack_(), scratch_(),
+      error_(), errorLocation_() {}
+
+bool EventReader::parse(const std::string& document, EventHandler& handler) {
+  const char* begin = document.c_str();
+  return parse(begin, begin + document.length(), handler);
+}
+
+bool EventReader::parse(const char* beginDoc,
+                        const char* endDoc,
+                        EventHandler& handler) {
+  begin_ = beginDoc;
+  end_ = endDoc;
+  current_ = begin_;
+  stack_.clear();
+  error_.clear();
+  errorLocation_ = 0;
+
+  // Each pass reads a value, the name of an object member, or what follows a
+  // value in the innermost open container. Comments are accepted where Reader
+  // accepts them: in place of a value only with allowComments_, around object
+  // members and after array elements always, between a name and its ':'
+  // never.
+  enum Expect { expectValue, expectName, expectSeparator };
+  Expect expect = expectValue;
+  Token token;
+  for (;;) {
+    switch (expect) {
+    case expectValue:
+      readSignificantToken(token);
+      if (stack_.empty() && features_.strictRoot_ &&
+          token.type_ != tokenObjectBegin && token.type_ != tokenArrayBegin)
+        return addError(
+            "A valid JSON document must be either an array or an object value.",
+            token.start_);
+      switch (token.type_) {
+      case tokenObjectBegin:
+        if (!handler.onStartObject())
+          return false;
+        stack_.push_back('{');
+        expect = expectName;
+        continue;
+      case tokenArrayBegin:
+        if (!handler.onStartArray())
+          return false;
+        // as in Reader, only spaces may stand between the brackets of an
+        // empty array
+        skipSpaces();
+        if (current_ != end_ && *current_ == ']') {
+          ++current_;
+          if (!handler.onEndArray())
+            return false;
+          break;
+        }
+        stack_.push_back('[');
+        continue;
+      case tokenArraySeparator:
+        if (features_.allowDroppedNullPlaceholders_) {
+          // "Un-read" the separator, the missing value is a null
+          current_ = token.start_;
+          if (!handler.onNull())
+            return false;
+          break;
+        }
+        return addError("Syntax error: value, object or array expected.",
+                        token.start_);
+      default:
+        if (!emitScalar(token, handler))
+          return false;
+        break;
+      }
+      if (stack_.empty())
+        return true;
+      expect = expectSeparator;
+      break;
+
+    case expectName:
+      readTokenAfterComments(token);
+      // Reader takes '}' for the end of the object only while the last member
+      // name read in it is empty, which makes {"":1,} valid
+      if (token.type_ == tokenObjectEnd && stack_.back() == '{') {
+        if (!closeContainer(handler))
+          return false;
+        if (stack_.empty())
+          return true;
+        expect = expectSeparator;
+        break;
+      }
+      if (!readName(token, handler))
+        return false;
+      expect = expectValue;
+      break;
+
+    case expectSeparator:
+      if (stack_.back() == '[') {
+        readTokenAfterComments(token);
+        if (token.type_ == tokenArraySeparator) {
+          expect = expectValue;
+          break;
+        }
+        if (token.type_ != tokenArrayEnd)
+          return addError("Missing ',' or ']' in array declaration",
+                          token.start_);
+      } else {
+        readToken(token);
+        // after a comment Reader takes any token for the ','
+        bool afterComment = token.type_ == tokenComment;
+        while (token.type_ == tokenComment)
+          readToken(token);
+        if (token.type_ == tokenArraySeparator ||
+            (afterComment && token.type_ != tokenObjectEnd)) {
+          expect = expectName;
+          break;
+        }
+        if (token.type_ != tokenObjectEnd)
+          return addError("Missing ',' or '}' in object declaration",
+                          token.start_);
+      }
+      if (!closeContainer(handler))
+        return false;
+      if (stack_.empty())
+        return true;
+      break;
+    }
+  }
+}
+
+bool EventReader::closeContainer(EventHandler& handler) {
+  bool isArray = stack_.back() == '[';
+  stack_.pop_back();
+  return isArray ? handler.onEndArray() : handler.onEndObject();
+}
+
+namespace {
+// Reader names a member with a numeric key after the decoded number
+class NumberName : public EventHandler {
+public:
+  std::string text;
+  bool onInt(LargestInt value) {
+    text = valueToString(value);
+    return true;
+  }
+  bool onUInt(LargestUInt value) {
+    text = valueToString(value);
+    return true;
+  }
+  bool onDouble(double value) {
+    text = valueToString(value);
+    return true;
+  }
+};
+} // namespace
+
+// A member name and its ':', inside an object
+bool EventReader::readName(Token& token, EventHandler& handler) {
+  if (token.type_ == tokenString) {
+    if (!emitString(token, handler, true))
+      return false;
+    // any escape decodes to at least one character
+    stack_.back() = token.end_ - token.start_ > 2 ? ':' : '{';
+  } else if (token.type_ == tokenNumber && features_.allowNumericKeys_) {
+    NumberName name;
+    if (!emitNumber(token, name) ||
+        !handler.onKey(name.text.data(), name.text.data() + name.text.size()))
+      return false;
+    stack_.back() = ':';
+  } else {
+    return addError("Missing '}' or object member name", token.start_);
+  }
+  readToken(token);
+  if (token.type_ != tokenMemberSeparator)
+    return addError("Missing ':' after object member name", token.start_);
+  return true;
+}
+
+bool EventReader::emitScalar(Token& token, EventHandler& handler) {
+  switch (token.type_) {
+  case tokenNumber:
+    return emitNumber(token, handler);
+  case tokenString:
+    return emitString(token, handler, false);
+  case tokenTrue:
+    return handler.onBool(true);
+  case tokenFalse:
+    return handler.onBool(false);
+  case tokenNull:
+    return handler.onNull();
+  default:
+    return addError("Syntax error: value, object or array expected.",
+                    token.start_);
+  }
+}
+
+bool EventReader::emitNumber(Token& token, EventHandler& handler) {
+  bool isDouble = false;
+  for (Location inspect = token.start_; inspect != token.end_; ++inspect) {
+    isDouble = isDouble || *inspect == '.' || *inspect == 'e' ||
+               *inspect == 'E' || *inspect == '+' ||
+               (*inspect == '-' && inspect != token.start_);
+  }
+  if (isDouble)
+    return emitDouble(token, handler);
+  Location current = token.start_;
+  bool isNegative = *current == '-';
+  if (isNegative)
+    ++current;
+  Value::LargestUInt maxIntegerValue =
+      isNegative ? Value::LargestUInt(Value::maxLargestInt) + 1
+                 : Value::maxLargestUInt;
+  Value::LargestUInt threshold = maxIntegerValue / 10;
+  Value::LargestUInt value = 0;
+  while (current < token.end_) {
+    Char c = *current++;
+    if (c < '0' || c > '9')
+      return addError("'" + std::string(token.start_, token.end_) +
+                          "' is not a number.",
+                      token.start_);
+    Value::UInt digit(c - '0');
+    if (value >= threshold) {
+      // as in Reader::decodeNumber, anything that would overflow is a double
+      if (value > threshold || current != token.end_ ||
+          digit > maxIntegerValue % 10) {
+        return emitDouble(token, handler);
+      }
+    }
+    value = value * 10 + digit;
+  }
+  if (isNegative)
+    return handler.onInt(Value::LargestInt(~value + 1));
+  if (value <= Value::LargestUInt(Value::maxLargestInt))
+    return handler.onInt(Value::LargestInt(value));
+  return handler.onUInt(value);
+}
+
+bool EventReader::emitDouble(Token& token, EventHandler& handler) {
+  double value = 0;
+  const int bufferSize = 32;
+  int count;
+  int length = int(token.end_ - token.start_);
+  char format[] = "%lf";
+  if (length <= bufferSize) {
+    Char buffer[bufferSize + 1];
+    memcpy(buffer, token.start_, length);
+    buffer[length] = 0;
+    count = sscanf(buffer, format, &value);
+  } else {
+    std::string buffer(token.start_, token.end_);
+    count = sscanf(buffer.c_str(), format, &value);
+  }
+  if (count != 1)
+    return addError("'" + std::string(token.start_, token.end_) +
+                        "' is not a number.",
+                    token.start_);
+  return handler.onDouble(value);
+}
+
+// Strings without escapes are passed in place; the rest go through scratch_
+bool EventReader::emitString(Token& token, EventHandler& handler, bool isKey) {
+  Location current = token.start_ + 1; // skip '"'
+  Location end = token.end_ - 1;       // do not include '"'
+  Location escape = static_cast<Location>(memchr(current, '\\', end - current));
+  if (!escape)
+    return isKey ? handler.onKey(current, end) : handler.onString(current, end);
+
+  scratch_.assign(current, escape);
+  current = escape;
+  while (current != end) {
+    Char c = *current++;
+    if (c != '\\') {
+      scratch_ += c;
+      continue;
+    }
+    if (current == end)
+      return addError("Empty escape sequence in string", current);
+    Char escaped = *current++;
+    switch (escaped) {
+    case '"':
+      scratch_ += '"';
+      break;
+    case '/':
+      scratch_ += '/';
+      break;
+    case '\\':
+      scratch_ += '\\';
+      break;
+    case 'b':
+      scratch_ += '\b';
+      break;
+    case 'f':
+      scratch_ += '\f';
+      break;
+    case 'n':
+      scratch_ += '\n';
+      break;
+    case 'r':
+      scratch_ += '\r';
+      break;
+    case 't':
+      scratch_ += '\t';
+      break;
+    case 'u': {
+      unsigned int unicode;
+      if (!decodeUnicodeEscapeSequence(current, end, unicode))
+        return false;
+      if (unicode >= 0xD800 && unicode <= 0xDBFF) {
+        // surrogate pairs
+        if (end - current < 6)
+          return addError("additional six characters expected to parse "
+                          "unicode surrogate pair.",
+                          current);
+        unsigned int surrogatePair;
+        if (*(current++) != '\\' || *(current++) != 'u')
+          return addError("expecting another \\u token to begin the second "
+                          "half of a unicode surrogate pair",
+                          current);
+        if (!decodeUnicodeEscapeSequence(current, end, surrogatePair))
+          return false;
+        unicode = 0x10000 + ((unicode & 0x3FF) << 10) + (surrogatePair & 0x3FF);
+      }
+      scratch_ += codePointToUTF8(unicode);
+    } break;
+    default:
+      return addError("Bad escape sequence in string", current);
+    }
+  }
+  const char* text = scratch_.data();
+  return isKey ? handler.onKey(text, text + scratch_.size())
+               : handler.onString(text, text + scratch_.size());
+}
+
+bool EventReader::decodeUnicodeEscapeSequence(Location& current,
+                                              Location end,
+                                              unsigned int& unicode) {
+  if (end - current < 4)
+    return addError(
+        "Bad unicode escape sequence in string: four digits expected.",
+        current);
+  unicode = 0;
+  for (int index = 0; index < 4; ++index) {
+    Char c = *current++;
+    unicode *= 16;
+    if (c >= '0' && c <= '9')
+      unicode += c - '0';
+    else if (c >= 'a' && c <= 'f')
+      unicode += c - 'a' + 10;
+    else if (c >= 'A' && c <= 'F')
+      unicode += c - 'A' + 10;
+    else
+      return addError(
+          "Bad unicode escape sequence in string: hexadecimal digit expected.",
+          current);
+  }
+  return true;
+}
+
+// In place of a value comments are skipped only with allowComments_; one that
+// is not allowed is an error token
+bool EventReader::readSignificantToken(Token& token) {
+  do {
+    readToken(token);
+  } while (token.type_ == tokenComment && features_.allowComments_);
+  if (token.type_ == tokenComment)
+    token.type_ = tokenError;
+  return token.type_ != tokenError;
+}
+
+// Between container members comments are skipped whatever the features say
+void EventReader::readTokenAfterComments(Token& token) {
+  do {
+    readToken(token);
+  } while (token.type_ == tokenComment);
+}
+
+bool EventReader::readToken(Token& token) {
+  skipSpaces();
+  token.start_ = current_;
+  Char c = getNextChar();
+  bool ok = true;
+  switch (c) {
+  case '{':
+    token.type_ = tokenObjectBegin;
+    break;
+  case '}':
+    token.type_ = tokenObjectEnd;
+    break;
+  case '[':
+    token.type_ = tokenArrayBegin;
+    break;
+  case ']':
+    token.type_ = tokenArrayEnd;
+    break;
+  case '"':
+    token.type_ = tokenString;
+    ok = readString();
+    break;
+  case '/':
+    token.type_ = tokenComment;
+    ok = readComment();
+    break;
+  case '0':
+  case '1':
+  case '2':
+  case '3':
+  case '4':
+  case '5':
+  case '6':
+  case '7':
+  case '8':
+  case '9':
+  case '-':
+    token.type_ = tokenNumber;
+    readNumber();
+    break;
+  case 't':
+    token.type_ = tokenTrue;
+    ok = match("rue", 3);
+    break;
+  case 'f':
+    token.type_ = tokenFalse;
+    ok = match("alse", 4);
+    break;
+  case 'n':
+    token.type_ = tokenNull;
+    ok = match("ull", 3);
+    break;
+  case ',':
+    token.type_ = tokenArraySeparator;
+    break;
+  case ':':
+    token.type_ = tokenMemberSeparator;
+    break;
+  case 0:
+    token.type_ = tokenEndOfStream;
+    break;
+  default:
+    ok = false;
+    break;
+  }
+  if (!ok)
+    token.type_ = tokenError;
+  token.end_ = current_;
+  return true;
+}
+
+void EventReader::skipSpaces() {
+  while (current_ != end_) {
+    Char c = *current_;
+    if (c == ' ' || c == '\t' || c == '\r' || c == '\n')
+      ++current_;
+    else
+      break;
+  }
+}
+
+bool EventReader::match(Location pattern, int patternLength) {
+  if (end_ - current_ < patternLength)
+    return false;
+  int index = patternLength;
+  while (index--)
+    if (current_[index] != pattern[index])
+      return false;
+  current_ += patternLength;
+  return true;
+}
+
+bool EventReader::readComment() {
+  Char c = getNextChar();
+  if (c == '*') {
+    while (current_ != end_) {
+      c = getNextChar();
+      if (c == '*' && current_ != end_ && *current_ == '/')
+        break;
+    }
+    return getNextChar() == '/';
+  }
+  if (c == '/') {
+    while (current_ != end_) {
+      c = getNextChar();
+      if (c == '\r' || c == '\n')
+        break;
+    }
+    return true;
+  }
+  return false;
+}
+
+void EventReader::readNumber() {
+  while (current_ != end_) {
+    if (!(*current_ >= '0' && *current_ <= '9') &&
+        !in(*current_, '.', 'e', 'E', '+', '-'))
+      break;
+    ++current_;
+  }
+}
+
+bool EventReader::readString() {
+  Char c = 0;
+  while (current_ != end_) {
+    c = getNextChar();
+    if (c == '\\')
+      getNextChar();
+    else if (c == '"')
+      break;
+  }
+  return c == '"';
+}
+
+EventReader::Char EventReader::getNextChar() {
+  if (current_ == end_)
+    return 0;
+  return *current_++;
+}
+
+bool EventReader::addError(const std::string& message, Location location) {
+  error_ = message;
+  errorLocation_ = location;
+  return false;
+}
+
+std::string EventReader::getLocationLineAndColumn(Location location) const {
+  Location current = begin_;
+  Location lastLineStart = current;
+  int line = 0;
+  while (current < location && current != end_) {
+    Char c = *current++;
+    if (c == '\r') {
+      if (current != end_ && *current == '\n')
+        ++current;
+      lastLineStart = current;
+      ++line;
+    } else if (c == '\n') {
+      lastLineStart = current;
+      ++line;
+    }
+  }
+  char buffer[18 + 16 + 16 + 1];
+  snprintf(buffer, sizeof(buffer), "Line %d, Column %d", line + 1,
+           int(location - lastLineStart) + 1);
+  return buffer;
+}
+
+std::string EventReader::getFormattedErrorMessages() const {
+  if (error_.empty())
+    return "";
+  return "* " + getLocationLineAndColumn(errorLocation_) + "\n  " + error_ +
+         "\n";
+}
+
+} // namespace Json
+
+// //////////////////////////////////////////////////////////////////////
+// End of content of file: src/lib_json/json_event_reader.cpp
+// //////////////////////////////////////////////////////////////////////
+
+
+
+
+
+
 // //////////////////////////////////////////////////////////////////////
 // Beginning of content of file: src/lib_json/json_batchallocator.h
 // //////////////////////////////////////////////////////////////////////
@@ -1453,6 +2031,8 @@ ValueIterator& ValueIterator::operator=(const SelfType& other) {
 #include <cpptl/conststring.h>
 #endif
 #include <cstddef> // size_t
+#include <new>
+#include "jsoncpp/json_ext.h"
 
 #define JSON_ASSERT_UNREACHABLE assert(false)
 
@@ -1509,12 +2089,145 @@ static inline bool InRange(double d, T min, U max) {
 }
 #endif // if !defined(JSON_USE_INT64_DOUBLE_CONVERSION)
 
+// class ValueArena
+// //////////////////////////////////////////////////////////////////
+
+static thread_local ValueArena* currentValueArena = 0;
+
+ValueArena::ValueArena(size_t chunkSize)
+    : chunks_(0), current_(0), end_(0), chunkSize_(chunkSize), used_(0),
+      liveBlocks_(0) {}
+
+ValueArena::~ValueArena() {
+  JSON_ASSERT(liveBlocks_ == 0);
+  while (chunks_) {
+    Chunk* next = chunks_->next_;
+    free(chunks_);
+    chunks_ = next;
+  }
+}
+
+ValueArena::Scope::Scope(ValueArena& arena) : previous_(currentValueArena) {
+  currentValueArena = &arena;
+}
+
+ValueArena::Scope::~Scope() { currentValueArena = previous_; }
+
+bool ValueArena::parse(Reader& reader,
+                       const std::string& document,
+                       Value& root,
+                       bool collectComments) {
+  Scope scope(*this);
+  return reader.parse(document, root, collectComments);
+}
+
+bool ValueArena::parse(Reader& reader,
+                       const char* beginDoc,
+                       const char* endDoc,
+                       Value& root,
+                       bool collectComments) {
+  Scope scope(*this);
+  return reader.parse(beginDoc, endDoc, root, collectComments);
+}
+
+ValueArena::Chunk* ValueArena::newChunk(size_t size) {
+  Chunk* chunk = static_cast<Chunk*>(malloc(sizeof(Chunk) + size));
+  JSON_ASSERT_MESSAGE(chunk != 0,
+                      "in Json::ValueArena::allocate(): "
+                      "Failed to allocate a chunk");
+  chunk->size_ = size;
+  return chunk;
+}
+
+void* ValueArena::allocate(size_t size, size_t align) {
+  used_ += size;
+  char* start = reinterpret_cast<char*>(
+      (reinterpret_cast<size_t>(current_) + align - 1) & ~(align - 1));
+  if (current_ && size <= size_t(end_ - start)) {
+    current_ = start + size;
+    return start;
+  }
+  if (size > chunkSize_ / 4) {
+    // Large blocks get a chunk of their own, behind the one being filled.
+    Chunk* chunk = newChunk(size);
+    if (chunks_) {
+      chunk->next_ = chunks_->next_;
+      chunks_->next_ = chunk;
+    } else {
+      chunk->next_ = 0;
+      chunks_ = chunk;
+    }
+    return chunk + 1;
+  }
+  Chunk* chunk = newChunk(chunkSize_);
+  chunk->next_ = chunks_;
+  chunks_ = chunk;
+  current_ = reinterpret_cast<char*>(chunk + 1);
+  end_ = current_ + chunkSize_;
+  start = current_;
+  current_ += size;
+  return start;
+}
+
+void ValueArena::reset() {
+  JSON_ASSERT_MESSAGE(liveBlocks_ == 0,
+                      "in Json::ValueArena::reset(): "
+                      "Values allocated in the arena are still alive");
+  used_ = 0;
+  if (!chunks_)
+    return;
+  Chunk* chunk = chunks_->next_;
+  while (chunk) {
+    Chunk* next = chunk->next_;
+    free(chunk);
+    chunk = next;
+  }
+  chunks_->next_ = 0;
+  current_ = reinterpret_cast<char*>(chunks_ + 1);
+  end_ = current_ + chunks_->size_;
+}
+
+/// The strings and containers of Values. Each block starts with a header
+/// naming the ValueArena it came from, or null for malloc, so it is released
+/// correctly whichever arena is current by then, and the arena knows how many
+/// of its blocks are still live.
+struct ValueBlock {
+  union Header {
+    ValueArena* arena_;
+    double alignDouble_;
+    LargestInt alignInteger_;
+  };
+
+  static void* allocate(size_t size) {
+    ValueArena* arena = currentValueArena;
+    Header* header = static_cast<Header*>(
+        arena ? arena->allocate(sizeof(Header) + size, sizeof(Header))
+              : malloc(sizeof(Header) + size));
+    JSON_ASSERT_MESSAGE(header != 0,
+                        "in Json::ValueBlock::allocate(): "
+                        "Failed to allocate a value buffer");
+    header->arena_ = arena;
+    if (arena)
+      ++arena->liveBlocks_;
+    return header + 1;
+  }
+
+  static void release(void* value) {
+    Header* header = static_cast<Header*>(value) - 1;
+    if (header->arena_)
+      --header->arena_->liveBlocks_;
+    else
+      free(header);
+  }
+};
+
 /** Duplicates the specified string value.
  * @param value Pointer to the string to duplicate. Must be zero-terminated if
  *              length is "unknown".
  * @param length Length of the value. if equals to unknown, then it will be
  *               computed using strlen(value).
- * @return Pointer on the duplicate instance of string.
+ * @return Pointer on the duplicate instance of string, in the current
+ *         ValueArena if there is one.
  */
 static inline char* duplicateStringValue(const char* value,
                                          unsigned int length = unknown) {
@@ -1526,10 +2239,7 @@ static inline char* duplicateStringValue(const char* value,
   if (length >= (unsigned)Value::maxInt)
     length = Value::maxInt - 1;
 
-  char* newString = static_cast<char*>(malloc(length + 1));
-  JSON_ASSERT_MESSAGE(newString != 0,
-                      "in Json::Value::duplicateStringValue(): "
-                      "Failed to allocate string value buffer");
+  char* newString = static_cast<char*>(ValueBlock::allocate(length + 1));
   memcpy(newString, value, length);
   newString[length] = 0;
   return newString;
@@ -1537,7 +2247,33 @@ static inline char* duplicateStringValue(const char* value,
 
 /** Free the string duplicated by duplicateStringValue().
  */
-static inline void releaseStringValue(char* value) { free(value); }
+static inline void releaseStringValue(char* value) {
+  ValueBlock::release(value);
+}
+
+#ifndef JSON_VALUE_USE_INTERNAL_MAP
+/** Allocates the container of an array or object, in the current ValueArena
+ * if there is one.
+ */
+static inline Value::ObjectValues* newObjectValues() {
+  return new (ValueBlock::allocate(sizeof(Value::ObjectValues)))
+      Value::ObjectValues();
+}
+
+static inline Value::ObjectValues*
+newObjectValues(const Value::ObjectValues& other) {
+  return new (ValueBlock::allocate(sizeof(Value::ObjectValues)))
+      Value::ObjectValues(other);
+}
+
+/** Destroys a container allocated by newObjectValues().
+ */
+static inline void releaseObjectValues(Value::ObjectValues* values) {
+  typedef Value::ObjectValues ObjectValues;
+  values->~ObjectValues();
+  ValueBlock::release(values);
+}
+#endif // ifndef JSON_VALUE_USE_INTERNAL_MAP
 
 } // namespace Json
 
@@ -1682,7 +2418,7 @@ Value::Value(ValueType type)
 #ifndef JSON_VALUE_USE_INTERNAL_MAP
   case arrayValue:
   case objectValue:
-    value_.map_ = new ObjectValues();
+    value_.map_ = newObjectValues();
     break;
 #else
   case arrayValue:
@@ -1855,7 +2591,7 @@ Value::Value(const Value& other)
 #ifndef JSON_VALUE_USE_INTERNAL_MAP
   case arrayValue:
   case objectValue:
-    value_.map_ = new ObjectValues(*other.value_.map_);
+    value_.map_ = newObjectValues(*other.value_.map_);
     break;
 #else
   case arrayValue:
@@ -1893,7 +2629,7 @@ Value::~Value() {
 #ifndef JSON_VALUE_USE_INTERNAL_MAP
   case arrayValue:
   case objectValue:
-    delete value_.map_;
+    releaseObjectValues(value_.map_);
     break;
 #else
   case arrayValue:
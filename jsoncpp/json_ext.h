@@ -0,0 +1,299 @@
+// Extensions to the bundled jsoncpp (jsoncpp.cpp) that are not part of the
+// upstream json.h. Botzone links its own copy of the library, so only local
+// builds that compile jsoncpp.cpp can use them.
+
+#ifndef JSON_EXT_H_INCLUDED
+#define JSON_EXT_H_INCLUDED
+
+#include "jsoncpp/json.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace Json {
+
+/** \brief Flat, read-only lookup table over the members of an object.
+ *
+ * ObjectValues is a std::map fixed by json.h, so each lookup walks tree nodes
+ * and compares C strings. For objects that are read many times, the index
+ * copies the member names into one buffer and keeps (name, Value address)
+ * entries in a contiguous array sorted by length, then bytes: small objects
+ * are scanned linearly, larger ones binary searched. It uses only the public
+ * Value API, so it is header-only and works with any jsoncpp.
+ *
+ * The index is a view: members added later are not in it, and it dangles once
+ * a member is removed or the object is destroyed.
+ */
+class ObjectIndex {
+public:
+  /// Objects up to this many members are scanned instead of searched.
+  enum { linearLimit = 8 };
+
+  ObjectIndex() {}
+  explicit ObjectIndex(const Value& object) { reset(object); }
+
+  /// Indexes object; anything but an object gives an empty index.
+  void reset(const Value& object) {
+    names_.clear();
+    members_.clear();
+    if (!object.isObject())
+      return;
+    for (Value::const_iterator it = object.begin(); it != object.end(); ++it) {
+      std::string name = it.key().asString();
+      Member member = { names_.size(), name.size(), &*it };
+      names_ += name;
+      members_.push_back(member);
+    }
+    std::sort(members_.begin(), members_.end(), Less(names_.data()));
+  }
+
+  /// The member, or 0 when there is none.
+  const Value* find(const char* key, size_t length) const {
+    const char* names = names_.data();
+    if (members_.size() <= linearLimit) {
+      for (size_t i = 0; i < members_.size(); ++i) {
+        const Member& member = members_[i];
+        if (member.length == length &&
+            memcmp(names + member.offset, key, length) == 0)
+          return member.value;
+      }
+      return 0;
+    }
+    Member probe = { 0, length, 0 };
+    std::vector<Member>::const_iterator it = std::lower_bound(
+        members_.begin(), members_.end(), probe, Less(names, key));
+    if (it == members_.end() || it->length != length ||
+        memcmp(names + it->offset, key, length) != 0)
+      return 0;
+    return it->value;
+  }
+  const Value* find(const char* key) const { return find(key, strlen(key)); }
+  const Value* find(const std::string& key) const {
+    return find(key.data(), key.size());
+  }
+
+  size_t size() const { return members_.size(); }
+
+private:
+  struct Member {
+    size_t offset; // of the name in names_
+    size_t length;
+    const Value* value;
+  };
+
+  // Orders members by name length, then bytes. A member without a value is
+  // the probe of a lookup, whose name is probeKey instead.
+  struct Less {
+    const char* names;
+    const char* probeKey;
+    explicit Less(const char* names, const char* probeKey = 0)
+        : names(names), probeKey(probeKey) {}
+    const char* name(const Member& member) const {
+      return member.value ? names + member.offset : probeKey;
+    }
+    bool operator()(const Member& a, const Member& b) const {
+      if (a.length != b.length)
+        return a.length < b.length;
+      return memcmp(name(a), name(b), a.length) < 0;
+    }
+  };
+
+  std::string names_; // member names back to back
+  std::vector<Member> members_;
+};
+
+/** \brief Callbacks for EventReader, one per value or container boundary.
+ *
+ * Every callback returns false to stop the parse, which then fails without an
+ * error message. Strings and keys are passed as [begin, end) ranges: into the
+ * document when the string holds no escape sequence, otherwise into a buffer
+ * owned by the reader, so they are only valid during the callback.
+ */
+class JSON_API EventHandler {
+public:
+  virtual ~EventHandler() {}
+
+  virtual bool onStartObject() { return true; }
+  virtual bool onKey(const char* /*begin*/, const char* /*end*/) { return true; }
+  virtual bool onEndObject() { return true; }
+  virtual bool onStartArray() { return true; }
+  virtual bool onEndArray() { return true; }
+  virtual bool onString(const char* /*begin*/, const char* /*end*/) {
+    return true;
+  }
+  /// Integers that fit LargestInt; larger ones go to onUInt.
+  virtual bool onInt(LargestInt /*value*/) { return true; }
+  virtual bool onUInt(LargestUInt /*value*/) { return true; }
+  /// Numbers with a fraction or exponent, and integers too large for onUInt.
+  virtual bool onDouble(double /*value*/) { return true; }
+  virtual bool onBool(bool /*value*/) { return true; }
+  virtual bool onNull() { return true; }
+};
+
+/** \brief Streaming JSON parser: reports a document to an EventHandler
+ * without building a Value.
+ *
+ * It accepts what Reader accepts with the same Features (comments, strict
+ * root, dropped null placeholders, numeric keys) and decodes numbers and
+ * strings the same way. Containers are tracked on an explicit stack instead
+ * of recursion, so memory is one byte per nesting level plus the scratch
+ * buffer for escaped strings, both reused between parses.
+ */
+class JSON_API EventReader {
+public:
+  typedef char Char;
+  typedef const Char* Location;
+
+  EventReader();
+  EventReader(const Features& features);
+
+  bool parse(const std::string& document, EventHandler& handler);
+  bool parse(const char* beginDoc, const char* endDoc, EventHandler& handler);
+
+  /// The error of the last parse, in the format of Reader; empty on success
+  /// or when a handler stopped the parse.
+  std::string getFormattedErrorMessages() const;
+
+private:
+  enum TokenType {
+    tokenEndOfStream = 0,
+    tokenObjectBegin,
+    tokenObjectEnd,
+    tokenArrayBegin,
+    tokenArrayEnd,
+    tokenString,
+    tokenNumber,
+    tokenTrue,
+    tokenFalse,
+    tokenNull,
+    tokenArraySeparator,
+    tokenMemberSeparator,
+    tokenComment,
+    tokenError
+  };
+
+  struct Token {
+    TokenType type_;
+    Location start_;
+    Location end_;
+  };
+
+  bool readToken(Token& token);
+  bool readSignificantToken(Token& token);
+  void readTokenAfterComments(Token& token);
+  void skipSpaces();
+  bool match(Location pattern, int patternLength);
+  bool readComment();
+  bool readString();
+  void readNumber();
+  bool readName(Token& token, EventHandler& handler);
+  bool closeContainer(EventHandler& handler);
+  bool emitScalar(Token& token, EventHandler& handler);
+  bool emitNumber(Token& token, EventHandler& handler);
+  bool emitDouble(Token& token, EventHandler& handler);
+  bool emitString(Token& token, EventHandler& handler, bool isKey);
+  bool decodeUnicodeEscapeSequence(Location& current,
+                                   Location end,
+                                   unsigned int& unicode);
+  bool addError(const std::string& message, Location location);
+  Char getNextChar();
+  std::string getLocationLineAndColumn(Location location) const;
+
+  Features features_;
+  Location begin_;
+  Location end_;
+  Location current_;
+  // per open container '[', or for an object '{' until a member with a
+  // non-empty name has been read and ':' after that
+  std::vector<char> stack_;
+  std::string scratch_;     // unescaped strings
+  std::string error_;
+  Location errorLocation_;
+};
+
+struct ValueBlock; // jsoncpp.cpp
+
+/** \brief Monotonic buffer for the strings and containers of Values.
+ *
+ * While a Scope is open on the current thread, string values, member names,
+ * comments and the object/array containers are carved out of the arena
+ * instead of being malloc'ed one by one. Releasing them only counts down; the
+ * memory comes back all at once on reset() or destruction, and a reset arena
+ * reuses its newest chunk, so a parse per turn stops touching the heap for
+ * them. The map nodes inside containers still come from std::allocator,
+ * because ObjectValues is fixed by json.h.
+ *
+ * Values built in a Scope may be copied, changed and destroyed after it
+ * closes (copies made outside any Scope use malloc again), but all of them
+ * must be destroyed before the arena is reset or destroyed: releasing a
+ * string or container reads its header, which by then would be recycled
+ * memory. The arena counts its live blocks, and reset() fails with
+ * JSON_ASSERT_MESSAGE, the destructor with JSON_ASSERT, while any is left.
+ */
+class JSON_API ValueArena {
+public:
+  explicit ValueArena(size_t chunkSize = 64 * 1024);
+  ~ValueArena();
+
+  /// Makes an arena the current one of this thread for its lifetime. Scopes
+  /// nest; the innermost wins.
+  class JSON_API Scope {
+  public:
+    explicit Scope(ValueArena& arena);
+    ~Scope();
+
+  private:
+    Scope(const Scope&);
+    void operator=(const Scope&);
+
+    ValueArena* previous_;
+  };
+
+  /// Reader::parse with every allocation of the resulting Value in the arena.
+  bool parse(Reader& reader,
+             const std::string& document,
+             Value& root,
+             bool collectComments = true);
+  bool parse(Reader& reader,
+             const char* beginDoc,
+             const char* endDoc,
+             Value& root,
+             bool collectComments = true);
+
+  /// \pre align is a power of two no larger than the alignment of malloc.
+  void* allocate(size_t size, size_t align = sizeof(double));
+  /// Forgets every allocation but keeps the newest chunk for reuse.
+  /// \pre liveBlocks() == 0
+  void reset();
+  /// Bytes handed out since construction or the last reset.
+  size_t used() const { return used_; }
+  /// Strings and containers of Values allocated here and not yet released.
+  size_t liveBlocks() const { return liveBlocks_; }
+
+private:
+  friend struct ValueBlock;
+
+  ValueArena(const ValueArena&);
+  void operator=(const ValueArena&);
+
+  struct Chunk {
+    Chunk* next_;
+    size_t size_;
+  };
+
+  Chunk* newChunk(size_t size);
+
+  Chunk* chunks_; // newest first
+  char* current_;
+  char* end_;
+  size_t chunkSize_;
+  size_t used_;
+  size_t liveBlocks_;
+};
+
+} // namespace Json
+
+#endif // JSON_EXT_H_INCLUDED
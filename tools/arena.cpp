@@ -0,0 +1,87 @@
+// Arena: plays two bot executables against each other on random symmetric maps
+// with the local referee (referee.h), many games at once.
+//
+// Every map is played twice with the sides swapped. Bots are shell commands, so
+// they can carry arguments. Build them with -D_BOTZONE_ONLINE so they talk over
+// stdin/stdout instead of in.txt/out.txt. A summary goes to stderr and the full
+// statistics as JSON to stdout.
+//
+//   arena --bot0 ./new --bot1 ./old [--games 200] [--threads N] [--time-ms 1000]
+//         [--seed 1]
+#include "referee.h"
+
+int main(int argc, char **argv)
+{
+    Tools::Options options(argc, argv);
+    string bots[2] = { options.GetString("bot0", ""), options.GetString("bot1", "") };
+    if (bots[0].empty() || bots[1].empty())
+    {
+        std::cerr << "usage: arena --bot0 <command> --bot1 <command> [--games 200] [--threads N]"
+            " [--time-ms 1000] [--seed 1]" << endl;
+        return 1;
+    }
+    int games = options.GetInt("games", 200) & ~1;
+    int threads = options.GetInt("threads", std::max(1, Tools::DefaultThreads() / 2));
+    double limitMs = options.GetDouble("time-ms", 1000);
+    unsigned seed = options.GetInt("seed", 1);
+
+    // game 2k and 2k+1 share a map; in the odd one bot0 plays red
+    vector<Tools::MatchResult> results(games);
+    int score[3] = {}; // bot0 wins, draws, bot1 wins
+    int finished = 0;
+    auto start = std::chrono::steady_clock::now();
+    Tools::RunGames(games, threads, [&](int game)
+    {
+        std::mt19937 rng(seed * 1000003u + game / 2);
+        Tools::MapSpec map = Tools::RandomMap(rng);
+        string order[2] = { bots[game & 1], bots[~game & 1] };
+        results[game] = Tools::PlayMatch(order, map, limitMs);
+    }, [&](int game)
+    {
+        const Tools::MatchResult &match = results[game];
+        int bot0 = game & 1;
+        score[match.result == TankGame::Draw ? 1 : match.result == bot0 ? 0 : 2]++;
+        std::cerr << "\rgame " << ++finished << "/" << games << "  +" << score[0] << " =" << score[1]
+            << " -" << score[2] << "   ";
+        return true;
+    });
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cerr << endl;
+
+    // per bot, not per side
+    vector<double> moveMs[2];
+    int timeouts[2] = {}, invalid[2] = {}, turns = 0;
+    for (int game = 0; game < games; game++)
+    {
+        const Tools::MatchResult &match = results[game];
+        turns += match.turns;
+        for (int side = 0; side < TankGame::sideCount; side++)
+        {
+            int bot = side ^ (game & 1);
+            moveMs[bot].insert(moveMs[bot].end(), match.moveMs[side].begin(), match.moveMs[side].end());
+            timeouts[bot] += match.timeouts[side];
+            invalid[bot] += match.invalid[side];
+        }
+    }
+
+    Json::Value report(Json::objectValue);
+    report["games"] = games;
+    report["wins"] = score[0];
+    report["draws"] = score[1];
+    report["losses"] = score[2];
+    report["score"] = games ? (score[0] + 0.5 * score[1]) / games : 0.5;
+    report["mean_turns"] = games ? (double)turns / games : 0;
+    report["seconds"] = seconds;
+    report["games_per_hour"] = games / seconds * 3600;
+    for (int bot = 0; bot < 2; bot++)
+    {
+        Json::Value &entry = report[bot ? "bot1" : "bot0"];
+        entry["command"] = bots[bot];
+        entry["timeouts"] = timeouts[bot];
+        entry["invalid"] = invalid[bot];
+        entry["time"] = Tools::TimeSummary(moveMs[bot]);
+    }
+    std::cerr << "bot0 " << score[0] << " wins, " << score[1] << " draws, " << score[2] << " losses; timeouts "
+        << timeouts[0] << "/" << timeouts[1] << ", invalid " << invalid[0] << "/" << invalid[1] << endl;
+    cout << Json::StyledWriter().write(report);
+}
@@ -0,0 +1,239 @@
+// Microbenchmarks for the rules engine, the evaluation and the search.
+//
+// Every benchmark cycles over a fixed corpus of positions (FastAgent self-play
+// on seeded random maps), so numbers are comparable between builds. Heap
+// allocations are counted by replacing the global operator new. Results go to
+// stdout as JSON.
+//
+//   bench [--positions 64] [--min-ms 200] [--iters 2000] [--searches 4] [--seed 1]
+#include "common.h"
+
+#include <new>
+
+static std::atomic<long long> allocations(0);
+
+// the replacements below pair malloc with free, which GCC cannot see through
+#if defined(__GNUC__) && __GNUC__ >= 11
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void *operator new(size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    free(p);
+}
+
+// keeps results alive so the compiler cannot drop the measured work
+static volatile double sink;
+
+struct Position
+{
+    TankGame::TankField field;
+    vector<Action> joint[2]; // valid joint actions per side
+};
+
+static vector<Position> Corpus(int count, unsigned seed)
+{
+    vector<Position> corpus;
+    FastAgent agent(8);
+    srand(seed);
+    for (int game = 0; (int)corpus.size() < count; game++)
+    {
+        std::mt19937 rng(seed * 1000003u + game);
+        TankGame::TankField field = Tools::RandomMap(rng).Field(0);
+        while (field.GetGameResult() == TankGame::NotFinished && (int)corpus.size() < count)
+        {
+            if (rng() % 4 == 0)
+            {
+                Position position;
+                position.field = field;
+                position.field.logs = std::stack<TankGame::DisappearLog>();
+                for (int side = 0; side < TankGame::sideCount; side++)
+                {
+                    position.field.mySide = side;
+                    for (auto &ranked : fastJudger.getBestBlocks(&position.field, Judger::maxJointActions))
+                        position.joint[side].push_back(ranked.first);
+                }
+                position.field.mySide = 0;
+                corpus.push_back(position);
+            }
+            Action blue = agent.getAction(&field);
+            field.mySide = 1;
+            Action red = agent.getAction(&field);
+            field.mySide = 0;
+            for (int tank = 0; tank < TankGame::tankPerSide; tank++)
+            {
+                field.nextAction[0][tank] = blue[tank];
+                field.nextAction[1][tank] = red[tank];
+            }
+            field.DoAction();
+        }
+    }
+    return corpus;
+}
+
+struct Result
+{
+    string name;
+    long long ops;
+    double nsPerOp, allocsPerOp;
+};
+
+// runs op(i) for i = 0, 1, ... in batches until minMs has passed
+template <typename Op>
+static Result Measure(const string &name, double minMs, Op op)
+{
+    for (int i = 0; i < 16; i++)
+        op(i);
+    long long ops = 0, batch = 16;
+    long long allocs = allocations;
+    auto start = std::chrono::steady_clock::now();
+    double ms = 0;
+    while (ms < minMs)
+    {
+        for (long long i = 0; i < batch; i++)
+            op(ops + i);
+        ops += batch;
+        batch *= 2;
+        ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+    Result result = { name, ops, ms * 1e6 / ops, (double)(allocations - allocs) / ops };
+    std::cerr << name << ": " << result.nsPerOp << " ns/op, " << result.allocsPerOp << " allocs/op" << endl;
+    return result;
+}
+
+int main(int argc, char **argv)
+{
+    Tools::Options options(argc, argv);
+    int count = options.GetInt("positions", 64);
+    double minMs = options.GetDouble("min-ms", 200);
+    int iterations = options.GetInt("iters", 2000);
+    int searches = options.GetInt("searches", 4);
+    unsigned seed = options.GetInt("seed", 1);
+
+    vector<Position> corpus = Corpus(count, seed);
+    size_t n = corpus.size();
+    vector<Result> results;
+    Judger judger;
+
+    results.push_back(Measure("TankField copy", minMs, [&](long long i)
+    {
+        TankGame::TankField copy(corpus[i % n].field);
+        sink = copy.currentTurn;
+    }));
+    results.push_back(Measure("DoAction+Revert", minMs, [&](long long i)
+    {
+        Position &position = corpus[i % n];
+        TankGame::TankField &field = position.field;
+        for (int side = 0; side < TankGame::sideCount; side++)
+        {
+            Action act = position.joint[side][(i / n) % position.joint[side].size()];
+            field.nextAction[side][0] = act[0];
+            field.nextAction[side][1] = act[1];
+        }
+        field.DoAction();
+        field.Revert();
+    }));
+    results.push_back(Measure("ActionIsValid x36", minMs, [&](long long i)
+    {
+        TankGame::TankField &field = corpus[i % n].field;
+        int valid = 0;
+        for (int side = 0; side < TankGame::sideCount; side++)
+            for (int tank = 0; tank < TankGame::tankPerSide; tank++)
+                for (int act = TankGame::Stay; act <= TankGame::LeftShoot; act++)
+                    valid += field.ActionIsValid(side, tank, (TankGame::Action)act);
+        sink = valid;
+    }));
+    results.push_back(Measure("getBestBlocks", minMs, [&](long long i)
+    {
+        sink = judger.getBestBlocks(&corpus[i % n].field, Judger::maxJointActions).size();
+    }));
+    results.push_back(Measure("spfa", minMs, [&](long long i)
+    {
+        // spfa starts from the tank, so it needs a live one
+        judger.field = &corpus[i % n].field;
+        int side = i & 1;
+        sink = judger.spfa(side, judger.field->tankAlive[side][0] ? 0 : 1);
+    }));
+    results.push_back(Measure("dp", minMs, [&](long long i)
+    {
+        judger.field = &corpus[i % n].field;
+        sink = judger.dp(i & 1);
+    }));
+    judger.evalCache.resize(0);
+    results.push_back(Measure("getScore", minMs, [&](long long i)
+    {
+        sink = judger.getScore(&corpus[i % n].field);
+    }));
+    judger.evalCache.resize(8 << 20);
+    results.push_back(Measure("getScore (cached)", minMs, [&](long long i)
+    {
+        sink = judger.getScore(&corpus[i % n].field);
+    }));
+
+    // agents with some visits spread over the actions, like a node mid-search
+    vector<MCTSAgent::ActionAgent> agents;
+    for (Position &position : corpus)
+    {
+        agents.emplace_back(&position.field, 0.05, 81);
+        MCTSAgent::ActionAgent &agent = agents.back();
+        for (int i = 0; i < agent.actionNum; i++)
+        {
+            agent.visitSum[i] = rand() % 50;
+            agent.winSum[i] = agent.visitSum[i] * (rand() % 100) / 100.0;
+        }
+    }
+    results.push_back(Measure("ActionAgent::getBest", minMs, [&](long long i)
+    {
+        sink = agents[i % n].getBest(1000);
+    }));
+
+    FastAgent fast(81);
+    results.push_back(Measure("VirtualGame::run(5)", minMs, [&](long long i)
+    {
+        sink = VirtualGame(&corpus[i % n].field).run(&fast, 5);
+    }));
+
+    MCTSAgent mcts(0.05, 81, 81, 5);
+    mcts.maxIterations = iterations;
+    mcts.timeLimit = std::numeric_limits<double>::infinity();
+    long long simulations = 0;
+    long long allocs = allocations;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < searches; i++)
+        simulations += mcts.search(&corpus[i * n / searches].field).iterations;
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cerr << "MCTSAgent::search: " << simulations / seconds << " simulations/s" << endl;
+
+    Json::Value report(Json::objectValue);
+    report["positions"] = (int)n;
+    report["seed"] = seed;
+    Json::Value &list = report["benchmarks"];
+    for (const Result &result : results)
+    {
+        Json::Value entry(Json::objectValue);
+        entry["name"] = result.name;
+        entry["ops"] = (Json::Int64)result.ops;
+        entry["ns_per_op"] = result.nsPerOp;
+        entry["allocs_per_op"] = result.allocsPerOp;
+        list.append(entry);
+    }
+    Json::Value &search = report["mcts"];
+    search["searches"] = searches;
+    search["iterations_per_search"] = iterations;
+    search["simulations_per_sec"] = simulations / seconds;
+    search["allocs_per_simulation"] = (double)(allocations - allocs) / std::max(1LL, simulations);
+    cout << Json::StyledWriter().write(report);
+}
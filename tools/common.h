@@ -0,0 +1,168 @@
+// Shared pieces of the offline tools. Every tool is a single translation unit
+// that includes the bot itself, so the tools always exercise the code that is
+// submitted to Botzone.
+#ifndef TANK2_TOOLS_COMMON_H
+#define TANK2_TOOLS_COMMON_H
+
+#define TANK2_NO_MAIN
+#ifndef TANK2_TRACE
+#define TANK2_NO_TRACE
+#endif
+#include "../MCTS.cpp"
+
+#include <random>
+#include <thread>
+#include <memory>
+#include <map>
+
+namespace Tools
+{
+    using TankGame::fieldHeight;
+    using TankGame::fieldWidth;
+
+    // A map as sent in the first request: three masks, 27 bits (3 rows) per int
+    struct MapSpec
+    {
+        int brick[3], water[3], steel[3];
+
+        TankGame::TankField Field(int mySide) const
+        {
+            int b[3], w[3], s[3];
+            for (int i = 0; i < 3; i++)
+                b[i] = brick[i], w[i] = water[i], s[i] = steel[i];
+            return TankGame::TankField(b, w, s, mySide);
+        }
+
+        // the first request the judge sends to mySide
+        string FirstRequest(int mySide) const
+        {
+            std::ostringstream out;
+            out << "{\"brickfield\":[" << brick[0] << ',' << brick[1] << ',' << brick[2]
+                << "],\"steelfield\":[" << steel[0] << ',' << steel[1] << ',' << steel[2]
+                << "],\"waterfield\":[" << water[0] << ',' << water[1] << ',' << water[2]
+                << "],\"mySide\":" << mySide << '}';
+            return out.str();
+        }
+    };
+
+    // Random point-symmetric map. Spawns, bases and the cells in front of the
+    // tanks stay empty, and every tank can reach the enemy base (through bricks).
+    inline MapSpec RandomMap(std::mt19937 &rng)
+    {
+        const double brickRate = 0.35, steelRate = 0.06, waterRate = 0.08;
+        std::uniform_real_distribution<double> uniform(0, 1);
+        while (true)
+        {
+            MapSpec map = {};
+            int item[fieldHeight][fieldWidth] = {};
+            bool reserved[fieldHeight][fieldWidth] = {};
+            for (int side = 0; side < TankGame::sideCount; side++)
+            {
+                reserved[TankGame::baseY[side]][TankGame::baseX[side]] = true;
+                for (int tank = 0; tank < TankGame::tankPerSide; tank++)
+                {
+                    int x = side == 0 ? fieldWidth / 2 - 2 + 4 * tank : fieldWidth / 2 + 2 - 4 * tank;
+                    int y = side == 0 ? 0 : fieldHeight - 1;
+                    reserved[y][x] = true;
+                    reserved[y + (side == 0 ? 1 : -1)][x] = true;
+                }
+            }
+            for (int y = 0; y < fieldHeight; y++)
+                for (int x = 0; x < fieldWidth; x++)
+                {
+                    int my = fieldHeight - 1 - y, mx = fieldWidth - 1 - x;
+                    if (y * fieldWidth + x > my * fieldWidth + mx || reserved[y][x] || reserved[my][mx])
+                        continue;
+                    double r = uniform(rng);
+                    int kind = r < brickRate ? TankGame::Brick
+                        : r < brickRate + steelRate ? TankGame::Steel
+                        : r < brickRate + steelRate + waterRate ? TankGame::Water : TankGame::None;
+                    item[y][x] = item[my][mx] = kind;
+                }
+
+            // checking blue is enough, the symmetry covers red
+            bool seen[fieldHeight][fieldWidth] = {};
+            int queueX[fieldHeight * fieldWidth], queueY[fieldHeight * fieldWidth], head = 0, tail = 0;
+            for (int tank = 0; tank < TankGame::tankPerSide; tank++)
+            {
+                int x = fieldWidth / 2 - 2 + 4 * tank;
+                seen[0][x] = true;
+                queueX[tail] = x, queueY[tail++] = 0;
+            }
+            bool reachable = false;
+            while (head < tail && !reachable)
+            {
+                int x = queueX[head], y = queueY[head++];
+                for (int dir = 0; dir < 4; dir++)
+                {
+                    int xx = x + TankGame::dx[dir], yy = y + TankGame::dy[dir];
+                    if (!TankGame::CoordValid(xx, yy) || seen[yy][xx])
+                        continue;
+                    if (xx == TankGame::baseX[1] && yy == TankGame::baseY[1])
+                        reachable = true;
+                    if (item[yy][xx] == TankGame::Steel || item[yy][xx] == TankGame::Water ||
+                        (xx == TankGame::baseX[0] && yy == TankGame::baseY[0]) || reachable)
+                        continue;
+                    seen[yy][xx] = true;
+                    queueX[tail] = xx, queueY[tail++] = yy;
+                }
+            }
+            if (!reachable)
+                continue;
+
+            for (int y = 0; y < fieldHeight; y++)
+                for (int x = 0; x < fieldWidth; x++)
+                {
+                    int bit = 1 << ((y % 3) * fieldWidth + x);
+                    if (item[y][x] == TankGame::Brick)
+                        map.brick[y / 3] |= bit;
+                    else if (item[y][x] == TankGame::Steel)
+                        map.steel[y / 3] |= bit;
+                    else if (item[y][x] == TankGame::Water)
+                        map.water[y / 3] |= bit;
+                }
+            return map;
+        }
+    }
+
+    // score of side for a finished game: win 1, draw 0.5, loss 0
+    inline double ResultFor(TankGame::GameResult result, int side)
+    {
+        return result == TankGame::Draw ? 0.5 : result == side ? 1 : 0;
+    }
+
+    // "--name value" command line options
+    struct Options
+    {
+        std::map<string, string> values;
+        Options(int argc, char **argv)
+        {
+            for (int i = 1; i + 1 < argc; i += 2)
+                if (!strncmp(argv[i], "--", 2))
+                    values[argv[i] + 2] = argv[i + 1];
+        }
+        string GetString(const string &name, const string &fallback) const
+        {
+            auto it = values.find(name);
+            return it == values.end() ? fallback : it->second;
+        }
+        long long GetInt(const string &name, long long fallback) const
+        {
+            auto it = values.find(name);
+            return it == values.end() ? fallback : atoll(it->second.c_str());
+        }
+        double GetDouble(const string &name, double fallback) const
+        {
+            auto it = values.find(name);
+            return it == values.end() ? fallback : atof(it->second.c_str());
+        }
+    };
+
+    inline int DefaultThreads()
+    {
+        unsigned n = std::thread::hardware_concurrency();
+        return n ? n : 1;
+    }
+}
+
+#endif
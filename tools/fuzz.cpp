@@ -0,0 +1,523 @@
+// Differential fuzzer for game engines.
+//
+// Plays random valid action sequences on random maps through the reference
+// engine (TankField::DoAction) and a candidate engine, comparing the full state
+// after every turn. On a mismatch the sequence is shrunk (delta debugging over
+// turns, then single actions turned into Stay) and the minimal repro is printed
+// as JSON: the map and the joint actions of each turn.
+//
+// Candidates implement Engine and are listed in MakeEngine. "revert" and
+// "replay" run other paths of TankField's own _doAction; "rules" is a separate
+// implementation of the game rules, the one that can disagree with it on
+// movement and shooting.
+//
+// Uniformly random actions end most games within ten turns, mostly by mutual
+// kills, so the random policy mostly moves: a tank shoots --shoot-percent of
+// the time, and a shot whose first obstacle is a tank is redrawn once at the
+// same odds. On success the coverage goes to stdout as JSON: game lengths,
+// bricks and bases destroyed, turns with stacked tanks.
+//
+//   fuzz [--engine rules|revert|replay] [--games 10000] [--seed 1] [--turns 100]
+//        [--shoot-percent 20]
+#include "common.h"
+
+#include <functional>
+
+struct JointAction
+{
+    TankGame::Action act[TankGame::sideCount][TankGame::tankPerSide];
+};
+
+// everything a correct engine must agree on after a turn
+struct Snapshot
+{
+    TankGame::FieldItem gameField[TankGame::fieldHeight][TankGame::fieldWidth];
+    int tankX[TankGame::sideCount][TankGame::tankPerSide], tankY[TankGame::sideCount][TankGame::tankPerSide];
+    bool tankAlive[TankGame::sideCount][TankGame::tankPerSide], baseAlive[TankGame::sideCount];
+    int currentTurn;
+    TankGame::GameResult result;
+
+    Snapshot() {}
+    Snapshot(const TankGame::TankField &field)
+    {
+        memcpy(gameField, field.gameField, sizeof(gameField));
+        memcpy(tankX, field.tankX, sizeof(tankX));
+        memcpy(tankY, field.tankY, sizeof(tankY));
+        memcpy(tankAlive, field.tankAlive, sizeof(tankAlive));
+        memcpy(baseAlive, field.baseAlive, sizeof(baseAlive));
+        currentTurn = field.currentTurn;
+        result = const_cast<TankGame::TankField &>(field).GetGameResult();
+    }
+
+    // first difference, or an empty string
+    string Diff(const Snapshot &other) const
+    {
+        std::ostringstream out;
+        for (int y = 0; y < TankGame::fieldHeight; y++)
+            for (int x = 0; x < TankGame::fieldWidth; x++)
+                if (gameField[y][x] != other.gameField[y][x])
+                {
+                    out << "cell (" << x << "," << y << "): " << gameField[y][x] << " vs " << other.gameField[y][x];
+                    return out.str();
+                }
+        for (int side = 0; side < TankGame::sideCount; side++)
+        {
+            for (int tank = 0; tank < TankGame::tankPerSide; tank++)
+                if (tankAlive[side][tank] != other.tankAlive[side][tank] ||
+                    (tankAlive[side][tank] && (tankX[side][tank] != other.tankX[side][tank] ||
+                    tankY[side][tank] != other.tankY[side][tank])))
+                {
+                    out << "tank " << side << "/" << tank;
+                    return out.str();
+                }
+            if (baseAlive[side] != other.baseAlive[side])
+            {
+                out << "base " << side;
+                return out.str();
+            }
+        }
+        if (currentTurn != other.currentTurn)
+            out << "turn " << currentTurn << " vs " << other.currentTurn;
+        else if (result != other.result)
+            out << "result " << result << " vs " << other.result;
+        return out.str();
+    }
+};
+
+// A game engine under test
+class Engine
+{
+    public:
+        virtual ~Engine() {}
+        virtual void load(const Tools::MapSpec &map) = 0;
+        // false when the engine rejects the actions
+        virtual bool play(const JointAction &joint) = 0;
+        virtual Snapshot snapshot() = 0;
+};
+
+class ReferenceEngine : public Engine
+{
+    public:
+        TankGame::TankField field;
+        void load(const Tools::MapSpec &map) override
+        {
+            field = map.Field(0);
+        }
+        bool play(const JointAction &joint) override
+        {
+            memcpy(field.nextAction, joint.act, sizeof(joint.act));
+            return field.DoAction();
+        }
+        Snapshot snapshot() override
+        {
+            return Snapshot(field);
+        }
+};
+
+// make/unmake: every turn is done, reverted and done again
+class RevertEngine : public ReferenceEngine
+{
+    public:
+        bool play(const JointAction &joint) override
+        {
+            memcpy(field.nextAction, joint.act, sizeof(joint.act));
+            if (!field.DoAction() || !field.Revert())
+                return false;
+            memcpy(field.nextAction, joint.act, sizeof(joint.act));
+            return field.DoAction();
+        }
+};
+
+// the trusted history replay path (TankField::ReplayAction)
+class ReplayEngine : public ReferenceEngine
+{
+    public:
+        bool play(const JointAction &joint) override
+        {
+            memcpy(field.nextAction, joint.act, sizeof(joint.act));
+            field.ReplayAction();
+            return true;
+        }
+};
+
+// The rules as the Botzone judge states them, kept apart from TankField: the
+// terrain and the tanks are separate, moves are checked against the state
+// before the turn, then every shot flies on the board after the moves and
+// everything hit goes at once. Only the constants and Snapshot are shared.
+class RulesEngine : public Engine
+{
+    public:
+        void load(const Tools::MapSpec &map) override
+        {
+            for (int y = 0; y < TankGame::fieldHeight; y++)
+                for (int x = 0; x < TankGame::fieldWidth; x++)
+                {
+                    int bit = 1 << (y % 3 * TankGame::fieldWidth + x), row = y / 3;
+                    terrain[y][x] = map.brick[row] & bit ? TankGame::Brick : map.water[row] & bit ? TankGame::Water
+                        : map.steel[row] & bit ? TankGame::Steel : TankGame::None;
+                }
+            const int startX[TankGame::sideCount][TankGame::tankPerSide] = { { 2, 6 }, { 6, 2 } };
+            for (int side = 0; side < TankGame::sideCount; side++)
+            {
+                terrain[TankGame::baseY[side]][TankGame::baseX[side]] = TankGame::Base;
+                baseAlive[side] = true;
+                for (int tank = 0; tank < TankGame::tankPerSide; tank++)
+                {
+                    x[side][tank] = startX[side][tank];
+                    y[side][tank] = side == TankGame::Blue ? 0 : TankGame::fieldHeight - 1;
+                    alive[side][tank] = true;
+                    shotLastTurn[side][tank] = false;
+                }
+            }
+            turn = 1;
+        }
+        bool play(const JointAction &joint) override
+        {
+            for (int side = 0; side < TankGame::sideCount; side++)
+                for (int tank = 0; tank < TankGame::tankPerSide; tank++)
+                    if (alive[side][tank] && !valid(side, tank, joint.act[side][tank]))
+                        return false;
+            for (int side = 0; side < TankGame::sideCount; side++)
+                for (int tank = 0; tank < TankGame::tankPerSide; tank++)
+                {
+                    TankGame::Action act = joint.act[side][tank];
+                    if (alive[side][tank] && act >= TankGame::Up && act <= TankGame::Left)
+                        x[side][tank] += TankGame::dx[act], y[side][tank] += TankGame::dy[act];
+                }
+            bool hit[TankGame::fieldHeight][TankGame::fieldWidth] = {};
+            for (int side = 0; side < TankGame::sideCount; side++)
+                for (int tank = 0; tank < TankGame::tankPerSide; tank++)
+                {
+                    TankGame::Action act = joint.act[side][tank];
+                    if (!alive[side][tank] || act < TankGame::UpShoot)
+                        continue;
+                    int dir = act - TankGame::UpShoot, cx = x[side][tank], cy = y[side][tank];
+                    while (true)
+                    {
+                        cx += TankGame::dx[dir], cy += TankGame::dy[dir];
+                        if (cx < 0 || cx >= TankGame::fieldWidth || cy < 0 || cy >= TankGame::fieldHeight)
+                            break;
+                        int s, t, tanks = tanksAt(cx, cy, s, t);
+                        if (tanks == 0 && (terrain[cy][cx] == TankGame::None || terrain[cy][cx] == TankGame::Water))
+                            continue;
+                        // two lone tanks shooting at each other: both shots vanish
+                        TankGame::Action reply = tanks == 1 ? joint.act[s][t] : TankGame::Stay;
+                        int me, mine;
+                        if (!(tanksAt(x[side][tank], y[side][tank], me, mine) == 1 &&
+                            reply >= TankGame::UpShoot && (reply - TankGame::UpShoot + 2) % 4 == dir))
+                            hit[cy][cx] = true;
+                        break;
+                    }
+                }
+            for (int cy = 0; cy < TankGame::fieldHeight; cy++)
+                for (int cx = 0; cx < TankGame::fieldWidth; cx++)
+                    if (hit[cy][cx])
+                    {
+                        for (int side = 0; side < TankGame::sideCount; side++)
+                        {
+                            for (int tank = 0; tank < TankGame::tankPerSide; tank++)
+                                if (alive[side][tank] && x[side][tank] == cx && y[side][tank] == cy)
+                                    alive[side][tank] = false;
+                            if (cx == TankGame::baseX[side] && cy == TankGame::baseY[side])
+                                baseAlive[side] = false;
+                        }
+                        if (terrain[cy][cx] != TankGame::Steel)
+                            terrain[cy][cx] = TankGame::None;
+                    }
+            for (int side = 0; side < TankGame::sideCount; side++)
+                for (int tank = 0; tank < TankGame::tankPerSide; tank++)
+                    shotLastTurn[side][tank] = joint.act[side][tank] >= TankGame::UpShoot;
+            turn++;
+            return true;
+        }
+        Snapshot snapshot() override
+        {
+            Snapshot shot;
+            memcpy(shot.gameField, terrain, sizeof(terrain));
+            bool lost[TankGame::sideCount];
+            for (int side = 0; side < TankGame::sideCount; side++)
+            {
+                for (int tank = 0; tank < TankGame::tankPerSide; tank++)
+                {
+                    shot.tankAlive[side][tank] = alive[side][tank];
+                    shot.tankX[side][tank] = alive[side][tank] ? x[side][tank] : -1;
+                    shot.tankY[side][tank] = alive[side][tank] ? y[side][tank] : -1;
+                    if (alive[side][tank])
+                        shot.gameField[y[side][tank]][x[side][tank]] =
+                            (TankGame::FieldItem)(shot.gameField[y[side][tank]][x[side][tank]] | TankGame::tankItemTypes[side][tank]);
+                }
+                shot.baseAlive[side] = baseAlive[side];
+                lost[side] = !baseAlive[side] || (!alive[side][0] && !alive[side][1]);
+            }
+            shot.currentTurn = turn;
+            shot.result = lost[TankGame::Blue] != lost[TankGame::Red] ? (lost[TankGame::Blue] ? TankGame::Red : TankGame::Blue)
+                : lost[TankGame::Blue] || turn > TankGame::maxTurn ? TankGame::Draw : TankGame::NotFinished;
+            return shot;
+        }
+
+    private:
+        TankGame::FieldItem terrain[TankGame::fieldHeight][TankGame::fieldWidth];
+        int x[TankGame::sideCount][TankGame::tankPerSide], y[TankGame::sideCount][TankGame::tankPerSide];
+        bool alive[TankGame::sideCount][TankGame::tankPerSide], baseAlive[TankGame::sideCount];
+        bool shotLastTurn[TankGame::sideCount][TankGame::tankPerSide];
+        int turn;
+
+        // live tanks on a cell; side and tank name one of them
+        int tanksAt(int cx, int cy, int &side, int &tank) const
+        {
+            int n = 0;
+            for (int s = 0; s < TankGame::sideCount; s++)
+                for (int t = 0; t < TankGame::tankPerSide; t++)
+                    if (alive[s][t] && x[s][t] == cx && y[s][t] == cy)
+                        side = s, tank = t, n++;
+            return n;
+        }
+        bool valid(int side, int tank, TankGame::Action act) const
+        {
+            if (act < TankGame::Stay || act > TankGame::LeftShoot)
+                return false;
+            if (act >= TankGame::UpShoot)
+                return !shotLastTurn[side][tank];
+            if (act == TankGame::Stay)
+                return true;
+            int cx = x[side][tank] + TankGame::dx[act], cy = y[side][tank] + TankGame::dy[act], s, t;
+            return cx >= 0 && cx < TankGame::fieldWidth && cy >= 0 && cy < TankGame::fieldHeight &&
+                terrain[cy][cx] == TankGame::None && tanksAt(cx, cy, s, t) == 0;
+        }
+};
+
+static Engine *MakeEngine(const string &name)
+{
+    if (name == "rules")
+        return new RulesEngine;
+    if (name == "revert")
+        return new RevertEngine;
+    if (name == "replay")
+        return new ReplayEngine;
+    return nullptr;
+}
+
+struct Case
+{
+    Tools::MapSpec map;
+    vector<JointAction> turns;
+};
+
+// turn at which the engines disagree (-1 when they agree), with the difference;
+// sequences the reference rejects are not failures
+static int FirstMismatch(const Case &c, Engine &candidate, string &diff)
+{
+    ReferenceEngine reference;
+    reference.load(c.map);
+    candidate.load(c.map);
+    for (size_t turn = 0; turn < c.turns.size(); turn++)
+    {
+        if (reference.field.GetGameResult() != TankGame::NotFinished || !reference.play(c.turns[turn]))
+            return -1;
+        if (!candidate.play(c.turns[turn]))
+        {
+            diff = "candidate rejected the actions";
+            return turn;
+        }
+        diff = reference.snapshot().Diff(candidate.snapshot());
+        if (!diff.empty())
+            return turn;
+    }
+    return -1;
+}
+
+// what the generated games exercised
+struct Coverage
+{
+    int games = 0, longest = 0, fullLength = 0; // fullLength: games that ran out of turns
+    long long turns = 0, bricks = 0, stackedTurns = 0;
+    int brickGames = 0, baseKills = 0, draws = 0;
+};
+
+static int CountBricks(const TankGame::TankField &field)
+{
+    int n = 0;
+    for (int y = 0; y < TankGame::fieldHeight; y++)
+        for (int x = 0; x < TankGame::fieldWidth; x++)
+            n += field.gameField[y][x] == TankGame::Brick;
+    return n;
+}
+
+// whether a shot from the tank's cell first meets another tank
+static bool ShotMeetsTank(const TankGame::TankField &field, int side, int tank, TankGame::Action act)
+{
+    int dir = act - TankGame::UpShoot, x = field.tankX[side][tank], y = field.tankY[side][tank];
+    while (true)
+    {
+        x += TankGame::dx[dir], y += TankGame::dy[dir];
+        if (!TankGame::CoordValid(x, y))
+            return false;
+        TankGame::FieldItem items = field.gameField[y][x];
+        if (items != TankGame::None && items != TankGame::Water)
+            return items >= TankGame::Blue0;
+    }
+}
+
+static Case RandomCase(std::mt19937 &rng, int maxTurns, int shootPercent, Coverage &coverage)
+{
+    Case c;
+    c.map = Tools::RandomMap(rng);
+    TankGame::TankField field = c.map.Field(0);
+    int bricks = CountBricks(field);
+    while ((int)c.turns.size() < maxTurns && field.GetGameResult() == TankGame::NotFinished)
+    {
+        JointAction joint;
+        for (int side = 0; side < TankGame::sideCount; side++)
+            for (int tank = 0; tank < TankGame::tankPerSide; tank++)
+            {
+                vector<TankGame::Action> moves, shots;
+                for (int act = TankGame::Stay; act <= TankGame::LeftShoot; act++)
+                    if (!field.tankAlive[side][tank] ? act == TankGame::Stay
+                        : field.ActionIsValid(side, tank, (TankGame::Action)act))
+                        (act >= TankGame::UpShoot ? shots : moves).push_back((TankGame::Action)act);
+                TankGame::Action act = moves[rng() % moves.size()];
+                if (!shots.empty() && (int)(rng() % 100) < shootPercent)
+                {
+                    TankGame::Action shot = shots[rng() % shots.size()];
+                    if (!ShotMeetsTank(field, side, tank, shot) || (int)(rng() % 100) < shootPercent)
+                        act = shot;
+                }
+                joint.act[side][tank] = act;
+            }
+        memcpy(field.nextAction, joint.act, sizeof(joint.act));
+        field.DoAction();
+        c.turns.push_back(joint);
+        for (int y = 0; y < TankGame::fieldHeight; y++)
+            for (int x = 0; x < TankGame::fieldWidth; x++)
+                if (field.gameField[y][x] >= TankGame::Blue0 && TankGame::HasMultipleTank(field.gameField[y][x]))
+                {
+                    coverage.stackedTurns++;
+                    y = TankGame::fieldHeight;
+                    break;
+                }
+    }
+    int destroyed = bricks - CountBricks(field);
+    coverage.games++;
+    coverage.turns += c.turns.size();
+    coverage.longest = std::max(coverage.longest, (int)c.turns.size());
+    coverage.fullLength += (int)c.turns.size() == maxTurns;
+    coverage.bricks += destroyed;
+    coverage.brickGames += destroyed > 0;
+    coverage.baseKills += !field.baseAlive[0] + !field.baseAlive[1];
+    coverage.draws += field.GetGameResult() == TankGame::Draw;
+    return c;
+}
+
+// ddmin over turns, then each remaining action replaced by Stay where possible
+static Case Shrink(Case c, const std::function<bool(const Case &)> &fails)
+{
+    size_t chunks = 2;
+    while (c.turns.size() >= 2)
+    {
+        size_t size = (c.turns.size() + chunks - 1) / chunks;
+        bool reduced = false;
+        for (size_t begin = 0; begin < c.turns.size(); begin += size)
+        {
+            Case trial = c;
+            trial.turns.erase(trial.turns.begin() + begin,
+                trial.turns.begin() + std::min(c.turns.size(), begin + size));
+            if (fails(trial))
+            {
+                c = trial;
+                chunks = std::max<size_t>(chunks - 1, 2);
+                reduced = true;
+                break;
+            }
+        }
+        if (!reduced)
+        {
+            if (chunks >= c.turns.size())
+                break;
+            chunks = std::min(chunks * 2, c.turns.size());
+        }
+    }
+    for (auto &joint : c.turns)
+        for (int side = 0; side < TankGame::sideCount; side++)
+            for (int tank = 0; tank < TankGame::tankPerSide; tank++)
+            {
+                TankGame::Action old = joint.act[side][tank];
+                if (old == TankGame::Stay)
+                    continue;
+                joint.act[side][tank] = TankGame::Stay;
+                if (!fails(c))
+                    joint.act[side][tank] = old;
+            }
+    return c;
+}
+
+int main(int argc, char **argv)
+{
+    Tools::Options options(argc, argv);
+    string name = options.GetString("engine", "rules");
+    int games = options.GetInt("games", 10000);
+    int maxTurns = options.GetInt("turns", 100);
+    unsigned seed = options.GetInt("seed", 1);
+    int shootPercent = options.GetInt("shoot-percent", 20);
+    std::unique_ptr<Engine> candidate(MakeEngine(name));
+    if (!candidate)
+    {
+        std::cerr << "fuzz: unknown engine " << name << endl;
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    Coverage coverage;
+    for (int game = 0; game < games; game++)
+    {
+        std::mt19937 rng(seed * 1000003u + game);
+        Case c = RandomCase(rng, maxTurns, shootPercent, coverage);
+        string diff;
+        int turn = FirstMismatch(c, *candidate, diff);
+        if (turn < 0)
+            continue;
+
+        std::cerr << "game " << game << ": mismatch at turn " << turn + 1 << ": " << diff << endl;
+        c.turns.resize(turn + 1);
+        c = Shrink(c, [&](const Case &trial)
+        {
+            string ignored;
+            return FirstMismatch(trial, *candidate, ignored) >= 0;
+        });
+        FirstMismatch(c, *candidate, diff);
+
+        Json::Value repro(Json::objectValue);
+        repro["engine"] = name;
+        repro["game"] = game;
+        repro["difference"] = diff;
+        Json::Reader().parse(c.map.FirstRequest(0), repro["map"]);
+        Json::Value &list = repro["turns"];
+        list = Json::Value(Json::arrayValue);
+        for (auto &joint : c.turns)
+        {
+            Json::Value entry(Json::arrayValue);
+            for (int side = 0; side < TankGame::sideCount; side++)
+                for (int tank = 0; tank < TankGame::tankPerSide; tank++)
+                    entry.append((int)joint.act[side][tank]);
+            list.append(entry);
+        }
+        cout << Json::StyledWriter().write(repro);
+        return 1;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cerr << games << " games, " << coverage.turns << " turns, no mismatch ("
+        << coverage.turns / seconds << " turns/s)" << endl;
+    Json::Value report(Json::objectValue);
+    report["engine"] = name;
+    report["games"] = games;
+    report["turns"] = (Json::UInt64)coverage.turns;
+    report["mean_turns"] = games ? 1. * coverage.turns / games : 0.;
+    report["longest_game"] = coverage.longest;
+    report["games_at_turn_limit"] = coverage.fullLength;
+    report["bricks_destroyed"] = (Json::UInt64)coverage.bricks;
+    report["games_with_bricks_destroyed"] = coverage.brickGames;
+    report["bases_destroyed"] = coverage.baseKills;
+    report["draws"] = coverage.draws;
+    report["turns_with_stacked_tanks"] = (Json::UInt64)coverage.stackedTurns;
+    cout << Json::StyledWriter().write(report);
+    return 0;
+}
@@ -0,0 +1,388 @@
+// Parse and lookup benchmark for the JSON that the bot and the tools handle.
+//
+// Two kinds of documents are generated from random games on seeded maps:
+//  - a Botzone request at --turn: the full request/response history plus a
+//    data blob of --data-bytes and a globaldata blob of --global-bytes, read
+//    by Json::Reader and by the bot's in-place TankGame::Internals::RequestParser;
+//  - a replay log of --games games in the shape of a Botzone match log, an
+//    array of judge entries ({"output":{"command","content":{"0","1"}}}) and
+//    bot entries ({"0":{"verdict","time","memory","debug","response"},"1"}).
+//
+// Lookups on the parsed Values go through std::map (Value::operator[] const)
+// and through Json::ObjectIndex (jsoncpp/json_ext.h), whose build cost is
+// timed separately. Reader also parses both documents inside a
+// Json::ValueArena, destroying the Value and resetting the arena each time.
+// Json::EventReader reads both documents without building a Value; on the
+// log it sums the responses while streaming, the same work as the std::map
+// scan plus its parse. Results go to stdout as JSON.
+//
+// The tool compiles jsoncpp.cpp into itself, so Reader is the parser Botzone
+// runs; build it without -ljsoncpp and against the json.h that jsoncpp.cpp
+// belongs to (see README).
+//
+//   jsonbench [--turn 100] [--data-bytes 9000] [--global-bytes 2000]
+//             [--games 20] [--min-ms 200] [--seed 1]
+#include "common.h"
+#include "../jsoncpp.cpp"
+
+// keeps results alive so the compiler cannot drop the measured work
+static volatile double sink;
+
+struct Result
+{
+    string name;
+    double nsPerOp, bytes; // bytes per op, 0 when not a parse
+};
+
+// runs op() in batches until minMs has passed
+template <typename Op>
+static Result Measure(const string &name, double minMs, double bytes, Op op)
+{
+    for (int i = 0; i < 4; i++)
+        op();
+    long long ops = 0, batch = 4;
+    auto start = std::chrono::steady_clock::now();
+    double ms = 0;
+    while (ms < minMs)
+    {
+        for (long long i = 0; i < batch; i++)
+            op();
+        ops += batch;
+        batch *= 2;
+        ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+    Result result = { name, ms * 1e6 / ops, bytes };
+    std::cerr << name << ": " << result.nsPerOp << " ns/op";
+    if (bytes)
+        std::cerr << ", " << bytes / result.nsPerOp * 1e3 << " MB/s";
+    std::cerr << endl;
+    return result;
+}
+
+// a game of random valid moves: the joint action of every turn
+static vector<TankGame::Action> RandomGame(std::mt19937 &rng, const Tools::MapSpec &map, int maxTurns)
+{
+    vector<TankGame::Action> moves;
+    TankGame::TankField field = map.Field(0);
+    for (int turn = 0; turn < maxTurns && field.GetGameResult() == TankGame::NotFinished; turn++)
+    {
+        for (int side = 0; side < TankGame::sideCount; side++)
+            for (int tank = 0; tank < TankGame::tankPerSide; tank++)
+            {
+                vector<TankGame::Action> valid;
+                for (int act = TankGame::Stay; act <= TankGame::LeftShoot; act++)
+                    if (!field.tankAlive[side][tank] ? act == TankGame::Stay
+                        : field.ActionIsValid(side, tank, (TankGame::Action)act))
+                        valid.push_back((TankGame::Action)act);
+                field.nextAction[side][tank] = valid[rng() % valid.size()];
+                moves.push_back(field.nextAction[side][tank]);
+            }
+        field.DoAction();
+    }
+    return moves;
+}
+
+// counts what the reader reports, so every event has a consumer
+class EventCount : public Json::EventHandler
+{
+    public:
+        size_t events = 0;
+
+        bool onStartObject() { return count(); }
+        bool onKey(const char *, const char *) { return count(); }
+        bool onStartArray() { return count(); }
+        bool onString(const char *, const char *) { return count(); }
+        bool onInt(Json::LargestInt) { return count(); }
+        bool onUInt(Json::LargestUInt) { return count(); }
+        bool onDouble(double) { return count(); }
+        bool onBool(bool) { return count(); }
+        bool onNull() { return count(); }
+
+    private:
+        bool count()
+        {
+            events++;
+            return true;
+        }
+};
+
+// response[0] + time over the bot entries of a match log, summed as the log
+// streams by: entries are at depth 2, bot records at depth 3
+class ResponseSum : public Json::EventHandler
+{
+    public:
+        long long sum = 0;
+
+        bool onStartObject() { return enter(); }
+        bool onStartArray() { return enter(); }
+        bool onEndObject() { return leave(); }
+        bool onEndArray() { return leave(); }
+        bool onKey(const char *begin, const char *end)
+        {
+            size_t length = end - begin;
+            if (depth == 2)
+                inBot = length == 1 && (*begin == '0' || *begin == '1');
+            else if (depth == 3)
+                field = length == 4 && !memcmp(begin, "time", 4) ? Time
+                    : length == 8 && !memcmp(begin, "response", 8) ? Response : Other;
+            return true;
+        }
+        bool onInt(Json::LargestInt value)
+        {
+            if (inBot && ((depth == 3 && field == Time) || (depth == 4 && field == Response && element++ == 0)))
+                sum += value;
+            return true;
+        }
+
+    private:
+        enum Field { Other, Time, Response };
+        int depth = 0, element = 0;
+        bool inBot = false;
+        Field field = Other;
+
+        bool enter()
+        {
+            depth++;
+            element = 0;
+            return true;
+        }
+        bool leave()
+        {
+            depth--;
+            return true;
+        }
+};
+
+static string RandomBlob(std::mt19937 &rng, size_t chars)
+{
+    vector<unsigned char> bytes(chars / 4 * 3);
+    for (auto &b : bytes)
+        b = rng();
+    return Base64Encode(bytes.data(), bytes.size());
+}
+
+static string Pair(const vector<TankGame::Action> &moves, int turn, int side)
+{
+    size_t at = (turn * TankGame::sideCount + side) * TankGame::tankPerSide;
+    return "[" + std::to_string(moves[at]) + "," + std::to_string(moves[at + 1]) + "]";
+}
+
+// what the judge sends to blue before turn + 1, without keep-running
+static string BotzoneRequest(std::mt19937 &rng, int turn, size_t dataBytes, size_t globalBytes)
+{
+    vector<TankGame::Action> moves;
+    Tools::MapSpec map;
+    do
+    {
+        map = Tools::RandomMap(rng);
+        moves = RandomGame(rng, map, turn);
+    } while ((int)moves.size() < turn * 4);
+    string requests = map.FirstRequest(0), responses;
+    for (int t = 0; t < turn; t++)
+    {
+        requests += "," + Pair(moves, t, 1);
+        responses += (t ? "," : "") + Pair(moves, t, 0);
+    }
+    return "{\"requests\":[" + requests + "],\"responses\":[" + responses + "],\"data\":\"" +
+        RandomBlob(rng, dataBytes) + "\",\"globaldata\":\"" + RandomBlob(rng, globalBytes) + "\"}";
+}
+
+static string ReplayLog(std::mt19937 &rng, int games)
+{
+    std::ostringstream log;
+    log << '[';
+    for (int game = 0; game < games; game++)
+    {
+        Tools::MapSpec map = Tools::RandomMap(rng);
+        vector<TankGame::Action> moves = RandomGame(rng, map, 200);
+        int turns = moves.size() / 4;
+        for (int turn = 0; turn <= turns; turn++)
+        {
+            log << (game || turn ? "," : "") << "{\"output\":{\"command\":\"" << (turn < turns ? "request" : "finish")
+                << "\",\"content\":{";
+            for (int side = 0; side < TankGame::sideCount; side++)
+                log << (side ? "," : "") << '"' << side << "\":"
+                    << (turn ? Pair(moves, turn - 1, 1 - side) : map.FirstRequest(side));
+            log << "}}}";
+            if (turn == turns)
+                break;
+            log << ",{";
+            for (int side = 0; side < TankGame::sideCount; side++)
+                log << (side ? "," : "") << '"' << side << "\":{\"verdict\":\"OK\",\"time\":" << 900 + rng() % 100
+                    << ",\"memory\":" << 60 + rng() % 10 << ",\"keep_running\":false,\"debug\":\"sims "
+                    << 5000 + rng() % 1000 << " nodes " << 5000 + rng() % 1000 << "\",\"response\":"
+                    << Pair(moves, turn, side) << '}';
+            log << '}';
+        }
+    }
+    log << ']';
+    return log.str();
+}
+
+int main(int argc, char **argv)
+{
+    Tools::Options options(argc, argv);
+    // the request parser keeps at most maxHistory turns
+    int turn = std::min<int>(options.GetInt("turn", 100), TankGame::Internals::RequestParser::maxHistory - 1);
+    size_t dataBytes = options.GetInt("data-bytes", 9000), globalBytes = options.GetInt("global-bytes", 2000);
+    int games = options.GetInt("games", 20);
+    double minMs = options.GetDouble("min-ms", 200);
+    unsigned seed = options.GetInt("seed", 1);
+
+    std::mt19937 rng(seed);
+    string request = BotzoneRequest(rng, turn, dataBytes, globalBytes);
+    string log = ReplayLog(rng, games);
+    vector<Result> results;
+    Json::Reader reader;
+
+    // the Botzone request
+    results.push_back(Measure("request: Json::Reader::parse", minMs, request.size(), [&]()
+    {
+        Json::Value value;
+        reader.parse(request, value);
+        sink = value.size();
+    }));
+    Json::ValueArena arena;
+    results.push_back(Measure("request: ValueArena::parse", minMs, request.size(), [&]()
+    {
+        {
+            Json::Value value;
+            arena.parse(reader, request, value);
+            sink = value.size();
+        }
+        arena.reset();
+    }));
+    Json::EventReader eventReader;
+    results.push_back(Measure("request: EventReader::parse", minMs, request.size(), [&]()
+    {
+        EventCount count;
+        eventReader.parse(request, count);
+        sink = count.events;
+    }));
+    TankGame::Internals::RequestParser &parser = TankGame::Internals::requestParser;
+    results.push_back(Measure("request: RequestParser::parse", minMs, request.size(), [&]()
+    {
+        sink = parser.parse(request.data(), request.data() + request.size());
+    }));
+
+    Json::Value input;
+    reader.parse(request, input);
+    const Json::Value &root = input, &map = input["requests"][0u];
+    const char *rootKeys[] = { "requests", "responses", "data", "globaldata" };
+    const char *mapKeys[] = { "brickfield", "steelfield", "waterfield", "mySide" };
+    results.push_back(Measure("request: 8 lookups, std::map", minMs, 0, [&]()
+    {
+        size_t n = 0;
+        for (const char *key : rootKeys)
+            n += root[key].size();
+        for (const char *key : mapKeys)
+            n += map[key].size();
+        sink = n;
+    }));
+    Json::ObjectIndex rootIndex(root), mapIndex(map);
+    results.push_back(Measure("request: 8 lookups, ObjectIndex", minMs, 0, [&]()
+    {
+        size_t n = 0;
+        for (const char *key : rootKeys)
+            n += rootIndex.find(key)->size();
+        for (const char *key : mapKeys)
+            n += mapIndex.find(key)->size();
+        sink = n;
+    }));
+    results.push_back(Measure("request: build 2 ObjectIndex", minMs, 0, [&]()
+    {
+        rootIndex.reset(root);
+        mapIndex.reset(map);
+        sink = rootIndex.size() + mapIndex.size();
+    }));
+
+    // the replay log: parse once, then read the responses of every bot entry
+    results.push_back(Measure("log: Json::Reader::parse", minMs, log.size(), [&]()
+    {
+        Json::Value value;
+        reader.parse(log, value);
+        sink = value.size();
+    }));
+    results.push_back(Measure("log: ValueArena::parse", minMs, log.size(), [&]()
+    {
+        {
+            Json::Value value;
+            arena.parse(reader, log, value);
+            sink = value.size();
+        }
+        arena.reset();
+    }));
+    Json::Value entries;
+    reader.parse(log, entries);
+    const char *sides[] = { "0", "1" };
+    results.push_back(Measure("log: scan responses, std::map", minMs, 0, [&]()
+    {
+        int sum = 0;
+        for (const Json::Value &entry : entries)
+            if (!entry.isMember("output"))
+                for (const char *side : sides)
+                    sum += entry[side]["response"][0u].asInt() + entry[side]["time"].asInt();
+        sink = sum;
+    }));
+    long long mapSum = 0;
+    for (const Json::Value &entry : entries)
+        if (!entry.isMember("output"))
+            for (const char *side : sides)
+                mapSum += entry[side]["response"][0u].asInt() + entry[side]["time"].asInt();
+    ResponseSum streamed;
+    eventReader.parse(log, streamed);
+    if (streamed.sum != mapSum)
+        std::cerr << "jsonbench: EventReader sums the log to " << streamed.sum << ", std::map scan to " << mapSum << endl;
+    results.push_back(Measure("log: EventReader::parse, sum responses", minMs, log.size(), [&]()
+    {
+        ResponseSum sum;
+        eventReader.parse(log, sum);
+        sink = sum.sum;
+    }));
+    vector<Json::ObjectIndex> entryIndex(entries.size()), botIndex(entries.size() * 2);
+    auto buildIndex = [&]()
+    {
+        for (Json::ArrayIndex i = 0; i < entries.size(); i++)
+        {
+            entryIndex[i].reset(entries[i]);
+            for (int side = 0; side < 2; side++)
+                if (const Json::Value *bot = entryIndex[i].find(sides[side]))
+                    botIndex[i * 2 + side].reset(*bot);
+        }
+    };
+    results.push_back(Measure("log: build ObjectIndex per entry", minMs, 0, [&]()
+    {
+        buildIndex();
+        sink = entryIndex.size();
+    }));
+    results.push_back(Measure("log: scan responses, ObjectIndex", minMs, 0, [&]()
+    {
+        int sum = 0;
+        for (size_t i = 0; i < entryIndex.size(); i++)
+            if (!entryIndex[i].find("output"))
+                for (int side = 0; side < 2; side++)
+                {
+                    const Json::ObjectIndex &bot = botIndex[i * 2 + side];
+                    sum += (*bot.find("response"))[0u].asInt() + bot.find("time")->asInt();
+                }
+        sink = sum;
+    }));
+
+    Json::Value report(Json::objectValue);
+    report["seed"] = seed;
+    report["request_bytes"] = (Json::UInt64)request.size();
+    report["request_turn"] = turn;
+    report["log_bytes"] = (Json::UInt64)log.size();
+    report["log_entries"] = entries.size();
+    Json::Value &list = report["benchmarks"];
+    for (const Result &result : results)
+    {
+        Json::Value entry(Json::objectValue);
+        entry["name"] = result.name;
+        entry["ns_per_op"] = result.nsPerOp;
+        if (result.bytes)
+            entry["mb_per_sec"] = result.bytes / result.nsPerOp * 1e3;
+        list.append(entry);
+    }
+    cout << Json::StyledWriter().write(report);
+}
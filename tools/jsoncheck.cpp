@@ -0,0 +1,320 @@
+// Differential check of the additions in jsoncpp/json_ext.h against the
+// bundled jsoncpp.
+//
+// Random documents (nested objects and arrays, integers around every
+// Int/UInt/Int64 boundary, doubles, escapes and surrogate pairs, comments,
+// odd whitespace), a share of them with a byte deleted, inserted or
+// replaced, are parsed by Json::Reader and by Json::EventReader under
+// Features::all(), Features::strictMode() and all() with numeric keys and
+// dropped null placeholders allowed. Both must accept or reject each
+// document, and on success a Value built from the EventReader callbacks must
+// equal Reader's. The first few mismatches are printed to stderr with the
+// document.
+//
+// Every document Reader accepts is also parsed in a Json::ValueArena with a
+// small chunk size and must equal the heap parse. A copy made outside the
+// Scope has to outlive the arena; reset() has to refuse while the parsed
+// Value is alive; destroying that Value inside another arena's Scope has to
+// count down the arena it came from. Run under -fsanitize=address to catch
+// a block that is read after its arena recycled it.
+//
+// Exits with 1 on any failure; a summary goes to stdout as JSON.
+//
+// The tool compiles jsoncpp.cpp into itself, so build it without -ljsoncpp
+// and against the json.h that jsoncpp.cpp belongs to (see README).
+//
+//   jsoncheck [--docs 20000] [--seed 1]
+#include "common.h"
+#include "../jsoncpp.cpp"
+
+// builds a Value the way Reader does from the EventReader callbacks
+class ValueBuilder : public Json::EventHandler
+{
+    public:
+        Json::Value root;
+
+        bool onStartObject() { return open(Json::objectValue); }
+        bool onStartArray() { return open(Json::arrayValue); }
+        bool onEndObject() { stack.pop_back(); return true; }
+        bool onEndArray() { stack.pop_back(); return true; }
+        bool onKey(const char *begin, const char *end)
+        {
+            key.assign(begin, end);
+            return true;
+        }
+        bool onString(const char *begin, const char *end) { return set(Json::Value(begin, end)); }
+        // Reader keeps non-negative integers above maxInt as uintValue
+        bool onInt(Json::LargestInt value)
+        {
+            return set(value > Json::Value::maxInt ? Json::Value(Json::LargestUInt(value)) : Json::Value(value));
+        }
+        bool onUInt(Json::LargestUInt value) { return set(Json::Value(value)); }
+        bool onDouble(double value) { return set(Json::Value(value)); }
+        bool onBool(bool value) { return set(Json::Value(value)); }
+        bool onNull() { return set(Json::Value()); }
+
+    private:
+        vector<Json::Value *> stack;
+        string key;
+
+        Json::Value &slot()
+        {
+            if (stack.empty())
+                return root;
+            Json::Value &parent = *stack.back();
+            return parent.isArray() ? parent[parent.size()] : parent[key];
+        }
+        bool set(const Json::Value &value)
+        {
+            slot() = value;
+            return true;
+        }
+        bool open(Json::ValueType type)
+        {
+            Json::Value &value = slot();
+            value = Json::Value(type);
+            stack.push_back(&value);
+            return true;
+        }
+};
+
+class DocumentGenerator
+{
+    public:
+        explicit DocumentGenerator(unsigned seed) : rng(seed) {}
+
+        string document()
+        {
+            string doc;
+            space(doc);
+            value(doc, 0);
+            space(doc);
+            if (rng() % 5 == 0)
+                mutate(doc);
+            return doc;
+        }
+
+    private:
+        std::mt19937 rng;
+
+        int pick(int n) { return rng() % n; }
+
+        void space(string &doc)
+        {
+            static const char *const blanks[] = { "", "", "", " ", "\n", "\t ", "\r\n  " };
+            doc += blanks[pick(7)];
+            if (pick(40) == 0)
+                doc += pick(2) ? "/* c */ " : "// c\n";
+        }
+        void value(string &doc, int depth)
+        {
+            switch (pick(depth > 5 ? 5 : 7))
+            {
+            case 0: number(doc); break;
+            case 1: text(doc); break;
+            case 2: doc += pick(2) ? "true" : "false"; break;
+            case 3: doc += "null"; break;
+            case 4: number(doc); break;
+            case 5:
+                doc += '[';
+                for (int i = 0, n = pick(5); i < n; i++)
+                {
+                    if (i)
+                        doc += ',';
+                    space(doc);
+                    // an empty slot is a dropped null placeholder
+                    if (pick(20))
+                        value(doc, depth + 1);
+                    space(doc);
+                }
+                if (pick(10) == 0)
+                    space(doc);
+                doc += ']';
+                break;
+            default:
+                doc += '{';
+                for (int i = 0, n = pick(5); i < n; i++)
+                {
+                    if (i)
+                        doc += ',';
+                    space(doc);
+                    if (pick(20))
+                        text(doc);
+                    else
+                        number(doc);
+                    space(doc);
+                    doc += ':';
+                    space(doc);
+                    value(doc, depth + 1);
+                    space(doc);
+                }
+                doc += '}';
+            }
+        }
+        void number(string &doc)
+        {
+            static const char *const edges[] = {
+                "0", "-0", "2147483647", "2147483648", "-2147483648", "-2147483649",
+                "4294967295", "4294967296", "9223372036854775807", "9223372036854775808",
+                "-9223372036854775808", "-9223372036854775809", "18446744073709551615",
+                "18446744073709551616", "123456789012345678901234567890",
+                "1.5", "-0.0", "1e3", "1E+3", "2.5e-3", "-1.25E-10", "1e400", "0.1234567890123456789"
+            };
+            if (pick(3))
+                doc += std::to_string((long long)(rng() % 2000001) - 1000000);
+            else
+                doc += edges[pick(sizeof(edges) / sizeof(edges[0]))];
+        }
+        void text(string &doc)
+        {
+            static const char *const pieces[] = {
+                "a", "key", "tank", " ", "\\\"", "\\\\", "\\/", "\\b", "\\f", "\\n", "\\r", "\\t",
+                "\\u0041", "\\u00e9", "\\u4e2d", "\\ud83d\\ude00", "\\u0000", "\xc3\xa9", "\xe4\xb8\xad"
+            };
+            doc += '"';
+            for (int i = 0, n = pick(5); i < n; i++)
+                doc += pieces[pick(sizeof(pieces) / sizeof(pieces[0]))];
+            doc += '"';
+        }
+        void mutate(string &doc)
+        {
+            static const char bytes[] = "{}[],:\"\\/*-.e0 ";
+            size_t at = rng() % (doc.size() + 1);
+            switch (pick(4))
+            {
+            case 0:
+                if (at < doc.size())
+                    doc.erase(at, 1);
+                break;
+            case 1: doc.insert(at, 1, bytes[pick(sizeof(bytes) - 1)]); break;
+            case 2:
+                if (at < doc.size())
+                    doc[at] = bytes[pick(sizeof(bytes) - 1)];
+                break;
+            default: doc.resize(at);
+            }
+        }
+};
+
+// one document through a ValueArena; false on any broken expectation
+static bool ArenaRoundTrip(const string &doc, const Json::Value &expected)
+{
+    Json::Reader reader;
+    Json::Value copy;
+    {
+        // small chunks, so documents span several and long strings get their own
+        Json::ValueArena arena(256), other(256);
+        {
+            // comments are collected too; assigning over a Value keeps its
+            // comments, so it is destroyed through the pointer instead
+            std::unique_ptr<Json::Value> value(new Json::Value);
+            Json::Value &parsed = *value;
+            if (!arena.parse(reader, doc, parsed) || !(parsed == expected))
+                return false;
+            copy = parsed;
+            bool live = arena.liveBlocks() > 0, refused = false;
+            try
+            {
+                arena.reset();
+            }
+            catch (const std::exception &)
+            {
+                refused = true;
+            }
+            if (refused != live)
+                return false;
+            // changes after the Scope mix malloc'ed blocks into the arena Value
+            if (parsed.isObject())
+                parsed["added after the scope"] = doc;
+            Json::ValueArena::Scope scope(other);
+            value.reset();
+            if (arena.liveBlocks() || other.liveBlocks())
+                return false;
+        }
+        arena.reset();
+        // reparse into the recycled chunk the copy must not point into
+        Json::Value again;
+        if (!arena.parse(reader, doc, again) || !(again == copy))
+            return false;
+    }
+    return copy == expected;
+}
+
+struct FeatureRun
+{
+    const char *name;
+    Json::Features features;
+    int accepted = 0, rejected = 0, mismatches = 0;
+};
+
+int main(int argc, char **argv)
+{
+    Tools::Options options(argc, argv);
+    int docs = options.GetInt("docs", 20000);
+    unsigned seed = options.GetInt("seed", 1);
+
+    FeatureRun runs[3];
+    runs[0].name = "all";
+    runs[0].features = Json::Features::all();
+    runs[1].name = "strict";
+    runs[1].features = Json::Features::strictMode();
+    runs[2].name = "lenient";
+    runs[2].features = Json::Features::all();
+    runs[2].features.allowNumericKeys_ = true;
+    runs[2].features.allowDroppedNullPlaceholders_ = true;
+
+    DocumentGenerator generator(seed);
+    int reported = 0, arenaDocs = 0, arenaFailures = 0;
+    for (int i = 0; i < docs; i++)
+    {
+        string doc = generator.document();
+        for (FeatureRun &run : runs)
+        {
+            Json::Reader reader(run.features);
+            Json::EventReader eventReader(run.features);
+            Json::Value expected;
+            ValueBuilder builder;
+            bool ok = reader.parse(doc, expected, false);
+            bool eventOk = eventReader.parse(doc, builder);
+            (ok ? run.accepted : run.rejected)++;
+            if (ok && &run == runs)
+            {
+                arenaDocs++;
+                if (!ArenaRoundTrip(doc, expected) && arenaFailures++ < 10)
+                    std::cerr << "ValueArena round trip fails on:\n" << doc << endl;
+            }
+            if (ok == eventOk && (!ok || expected == builder.root))
+                continue;
+            run.mismatches++;
+            if (reported++ < 10)
+                std::cerr << run.name << ": Reader " << (ok ? "accepts" : "rejects") << ", EventReader "
+                    << (eventOk ? "accepts" : "rejects") << (ok && eventOk ? " with a different value" : "")
+                    << ":\n" << doc << "\n" << eventReader.getFormattedErrorMessages() << endl;
+        }
+    }
+
+    bool ok = true;
+    Json::Value report(Json::objectValue);
+    report["docs"] = docs;
+    report["seed"] = seed;
+    Json::Value &list = report["features"];
+    for (const FeatureRun &run : runs)
+    {
+        Json::Value entry(Json::objectValue);
+        entry["name"] = run.name;
+        entry["accepted"] = run.accepted;
+        entry["rejected"] = run.rejected;
+        entry["mismatches"] = run.mismatches;
+        list.append(entry);
+        ok = ok && run.mismatches == 0;
+        std::cerr << run.name << ": " << run.accepted << " accepted, " << run.rejected << " rejected, "
+            << run.mismatches << " EventReader/Reader mismatches" << endl;
+    }
+    report["arena_docs"] = arenaDocs;
+    report["arena_failures"] = arenaFailures;
+    ok = ok && arenaFailures == 0;
+    std::cerr << "ValueArena: " << arenaDocs << " documents, " << arenaFailures << " failures" << endl;
+    report["ok"] = ok;
+    cout << Json::StyledWriter().write(report);
+    return ok ? 0 : 1;
+}
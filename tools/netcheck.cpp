@@ -0,0 +1,172 @@
+// Consistency check for PolicyValueNet inference.
+//
+// netWeights is empty until a trained net exists, so the int8 path is
+// exercised here with synthetic weight blobs in the loader's format: one with
+// random weights and one with every weight at -128 and every activation
+// driven to 127, the worst case for the AVX2 maddubs pairs. Each blob goes
+// through Base64Encode and the string loader, then every corpus position
+// (FastAgent self-play on seeded random maps, both sides to move) is
+// evaluated with the AVX2 kernel and with scalarOnly; policies and values
+// must be bit-identical. A truncated blob must be rejected. Exits with 1 on
+// any failure; a summary goes to stdout as JSON.
+//
+//   netcheck [--positions 64] [--seed 1]
+#include "common.h"
+
+static void PutU32(vector<unsigned char> &blob, unsigned value)
+{
+    PutBytes(blob, value);
+}
+
+// a blob in the layout documented at PolicyValueNet; weight(rng) and
+// bias(rng) give the entries, scales[l] the requantization scale
+template <typename Weight, typename Bias>
+static vector<unsigned char> SyntheticBlob(std::mt19937 &rng, const float scales[3], Weight weight, Bias bias)
+{
+    const int dims[3][2] = {
+        { PolicyValueNet::inputs, PolicyValueNet::hidden1 },
+        { PolicyValueNet::hidden1, PolicyValueNet::hidden2 },
+        { PolicyValueNet::hidden2, PolicyValueNet::outputs }
+    };
+    vector<unsigned char> blob = { 'T', '2', 'N', 'N' };
+    PutU32(blob, 1);
+    PutU32(blob, 3);
+    for (int l = 0; l < 3; l++)
+    {
+        PutU32(blob, dims[l][0]);
+        PutU32(blob, dims[l][1]);
+        PutBytes(blob, scales[l]);
+        for (int o = 0; o < dims[l][1]; o++)
+            for (int i = 0; i < dims[l][0]; i++)
+                blob.push_back((unsigned char)(signed char)weight(rng));
+        for (int o = 0; o < dims[l][1]; o++)
+            PutBytes(blob, (int)bias(rng));
+    }
+    return blob;
+}
+
+static vector<TankGame::TankField> Corpus(int count, unsigned seed)
+{
+    vector<TankGame::TankField> corpus;
+    corpus.reserve(count);
+    FastAgent agent(8);
+    srand(seed);
+    for (int game = 0; (int)corpus.size() < count; game++)
+    {
+        std::mt19937 rng(seed * 1000003u + game);
+        TankGame::TankField field = Tools::RandomMap(rng).Field(0);
+        while (field.GetGameResult() == TankGame::NotFinished && (int)corpus.size() < count)
+        {
+            if (rng() % 4 == 0)
+            {
+                corpus.emplace_back(field);
+                corpus.back().logs = std::stack<TankGame::DisappearLog>();
+            }
+            Action blue = agent.getAction(&field);
+            field.mySide = 1;
+            Action red = agent.getAction(&field);
+            field.mySide = 0;
+            for (int tank = 0; tank < TankGame::tankPerSide; tank++)
+            {
+                field.nextAction[0][tank] = blue[tank];
+                field.nextAction[1][tank] = red[tank];
+            }
+            field.DoAction();
+        }
+    }
+    return corpus;
+}
+
+struct CheckResult
+{
+    int evaluations = 0, mismatches = 0;
+    double minValue = 1, maxValue = 0;
+};
+
+static CheckResult Compare(PolicyValueNet &net, vector<TankGame::TankField> &corpus)
+{
+    CheckResult result;
+    for (TankGame::TankField &field : corpus)
+        for (int side = 0; side < TankGame::sideCount; side++)
+        {
+            field.mySide = side;
+            double simd[4][9], scalar[4][9];
+            net.scalarOnly = false;
+            double simdValue = net.evaluate(&field, simd);
+            net.scalarOnly = true;
+            double scalarValue = net.evaluate(&field, scalar);
+            result.evaluations++;
+            if (memcmp(&simdValue, &scalarValue, sizeof(double)) || memcmp(simd, scalar, sizeof(simd)))
+                result.mismatches++;
+            result.minValue = std::min(result.minValue, scalarValue);
+            result.maxValue = std::max(result.maxValue, scalarValue);
+        }
+    net.scalarOnly = false;
+    for (TankGame::TankField &field : corpus)
+        field.mySide = 0;
+    return result;
+}
+
+int main(int argc, char **argv)
+{
+    Tools::Options options(argc, argv);
+    int count = options.GetInt("positions", 64);
+    unsigned seed = options.GetInt("seed", 1);
+
+    vector<TankGame::TankField> corpus = Corpus(count, seed);
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> int8(-128, 127), smallBias(-2000, 2000);
+    // scales that keep the random net's activations spread over 0..127
+    const float randomScales[3] = { 0.05f, 0.0015f, 0.0001f };
+    const float saturatingScales[3] = { -1.0f, -1.0f, 0.0001f };
+    struct
+    {
+        const char *name;
+        vector<unsigned char> blob;
+    } blobs[2] = {
+        { "random", SyntheticBlob(rng, randomScales,
+            [&](std::mt19937 &r) { return int8(r); }, [&](std::mt19937 &r) { return smallBias(r); }) },
+        // all-negative weights times negative scales drive every hidden unit to 127
+        { "saturating", SyntheticBlob(rng, saturatingScales,
+            [](std::mt19937 &) { return -128; }, [](std::mt19937 &) { return 0; }) }
+    };
+
+    bool avx2 = false;
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    avx2 = __builtin_cpu_supports("avx2");
+#endif
+    bool ok = true;
+    Json::Value report(Json::objectValue);
+    report["positions"] = (int)corpus.size();
+    report["avx2"] = avx2;
+    Json::Value &list = report["blobs"];
+    for (auto &b : blobs)
+    {
+        PolicyValueNet net;
+        Json::Value entry(Json::objectValue);
+        entry["name"] = b.name;
+        entry["bytes"] = (Json::UInt64)b.blob.size();
+        bool truncatedRejected = !net.load(b.blob.data(), b.blob.size() - 1);
+        bool loaded = net.load(Base64Encode(b.blob.data(), b.blob.size()).c_str());
+        entry["loaded"] = loaded;
+        entry["truncated_rejected"] = truncatedRejected;
+        if (loaded)
+        {
+            CheckResult result = Compare(net, corpus);
+            entry["evaluations"] = result.evaluations;
+            entry["mismatches"] = result.mismatches;
+            entry["min_value"] = result.minValue;
+            entry["max_value"] = result.maxValue;
+            ok = ok && result.mismatches == 0;
+            std::cerr << b.name << ": " << result.evaluations << " evaluations, " << result.mismatches
+                << " AVX2/scalar mismatches, value in [" << result.minValue << ", " << result.maxValue << "]" << endl;
+        }
+        ok = ok && loaded && truncatedRejected;
+        list.append(entry);
+    }
+    if (!avx2)
+        std::cerr << "netcheck: no AVX2 on this CPU, both runs used the scalar kernel" << endl;
+    report["ok"] = ok;
+    cout << Json::StyledWriter().write(report);
+    return ok ? 0 : 1;
+}
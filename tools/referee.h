@@ -0,0 +1,315 @@
+// Local reimplementation of the Botzone Tank2 judge.
+//
+// Bots are executables that speak the Botzone simple-IO JSON protocol: every
+// turn a fresh process gets one line {"requests":[...],"responses":[...],
+// "data":...,"globaldata":...} on stdin and prints {"response":[a0,a1],...}.
+// A bot that ends its reply with a >>>BOTZONE_REQUEST_KEEP_RUNNING<<< line
+// stays alive and from then on gets only the opponent's move [a0,a1] per turn.
+// Both sides of a turn run concurrently, like on Botzone. A bot that misses the
+// time limit, crashes or answers an invalid move loses the game.
+#ifndef TANK2_TOOLS_REFEREE_H
+#define TANK2_TOOLS_REFEREE_H
+
+#include "common.h"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+namespace Tools
+{
+    // A bot process: Start launches it, then every turn Send writes the input
+    // and Read collects the reply. The process ends after its reply unless it
+    // asks to keep running.
+    struct BotProcess
+    {
+        pid_t pid = -1;
+        int in = -1, out = -1;
+        std::chrono::steady_clock::time_point start;
+
+        ~BotProcess()
+        {
+            Stop();
+        }
+
+        bool Running() const
+        {
+            return pid > 0;
+        }
+
+        // starts command through /bin/sh
+        bool Start(const string &command)
+        {
+            int toChild[2], fromChild[2];
+            if (pipe2(toChild, O_CLOEXEC) != 0)
+                return false;
+            if (pipe2(fromChild, O_CLOEXEC) != 0)
+            {
+                close(toChild[0]), close(toChild[1]);
+                return false;
+            }
+            pid = fork();
+            if (pid == 0)
+            {
+                dup2(toChild[0], 0);
+                dup2(fromChild[1], 1);
+                int devNull = open("/dev/null", O_WRONLY);
+                if (devNull >= 0)
+                    dup2(devNull, 2);
+                execl("/bin/sh", "sh", "-c", command.c_str(), (char *)nullptr);
+                _exit(127);
+            }
+            close(toChild[0]);
+            close(fromChild[1]);
+            in = toChild[1], out = fromChild[0];
+            if (pid < 0)
+            {
+                Stop();
+                return false;
+            }
+            // a bot that exits without reading gives EPIPE, which shows up as a bad reply
+            signal(SIGPIPE, SIG_IGN);
+            return true;
+        }
+
+        // writes one turn's input; the time limit counts from here
+        void Send(const string &input)
+        {
+            start = std::chrono::steady_clock::now();
+            const char *p = input.c_str();
+            size_t left = input.size();
+            while (left > 0)
+            {
+                ssize_t n = write(in, p, left);
+                if (n <= 0)
+                    break;
+                p += n, left -= n;
+            }
+        }
+
+        // reads the reply until the bot exits or asks to keep running, killing it
+        // once limitMs has passed since Send; false on a timeout
+        bool Read(double limitMs, string &output, double &elapsedMs)
+        {
+            static const string keepRunning = ">>>BOTZONE_REQUEST_KEEP_RUNNING<<<";
+            bool timedOut = false, alive = false;
+            char buffer[4096];
+            while (true)
+            {
+                double used = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                if (used > limitMs)
+                {
+                    timedOut = true;
+                    break;
+                }
+                pollfd fd = { out, POLLIN, 0 };
+                if (poll(&fd, 1, std::max(1, (int)(limitMs - used))) <= 0)
+                    continue;
+                ssize_t n = read(out, buffer, sizeof(buffer));
+                if (n <= 0)
+                    break;
+                output.append(buffer, n);
+                size_t marker = output.find(keepRunning);
+                if (marker != string::npos && output.find('\n', marker) != string::npos)
+                {
+                    output.resize(marker);
+                    alive = true;
+                    break;
+                }
+            }
+            elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            if (!alive)
+                Stop();
+            return !timedOut;
+        }
+
+        // kills the bot if it is still running
+        void Stop()
+        {
+            if (in >= 0)
+                close(in);
+            if (out >= 0)
+                close(out);
+            if (pid > 0)
+            {
+                kill(pid, SIGKILL);
+                waitpid(pid, nullptr, 0);
+            }
+            in = out = -1, pid = -1;
+        }
+    };
+
+    struct TurnReply
+    {
+        bool ok = false, timedOut = false;
+        Action action;
+        double ms = 0;
+        string data, globaldata;
+    };
+
+    // the last JSON line of the output carries the response
+    inline bool ParseReply(const string &output, TurnReply &reply)
+    {
+        size_t end = output.find_last_not_of(" \r\n");
+        if (end == string::npos)
+            return false;
+        size_t begin = output.rfind('\n', end);
+        begin = begin == string::npos ? 0 : begin + 1;
+        Json::Value value;
+        Json::Reader reader;
+        if (!reader.parse(output.substr(begin, end - begin + 1), value) || !value.isObject())
+            return false;
+        const Json::Value &response = value["response"];
+        if (!response.isArray() || response.size() != TankGame::tankPerSide)
+            return false;
+        for (int tank = 0; tank < TankGame::tankPerSide; tank++)
+        {
+            if (!response[tank].isInt() || response[tank].asInt() < TankGame::Stay ||
+                response[tank].asInt() > TankGame::LeftShoot)
+                return false;
+            reply.action[tank] = (TankGame::Action)response[tank].asInt();
+        }
+        reply.data = value["data"].asString();
+        reply.globaldata = value.isMember("globaldata") ? value["globaldata"].asString() : value["globalData"].asString();
+        return true;
+    }
+
+    struct MatchResult
+    {
+        TankGame::GameResult result = TankGame::Draw;
+        int turns = 0;
+        string reason;                  // how the game ended
+        vector<double> moveMs[2];       // per side
+        int timeouts[2] = {}, invalid[2] = {};
+    };
+
+    // Plays one game on map between bots[0] (blue) and bots[1] (red)
+    inline MatchResult PlayMatch(const string bots[2], const MapSpec &map, double limitMs)
+    {
+        MatchResult match;
+        TankGame::TankField field = map.Field(0);
+        Json::Value requests[2], responses[2];
+        string data[2], globaldata[2];
+        for (int side = 0; side < TankGame::sideCount; side++)
+        {
+            Json::Reader().parse(map.FirstRequest(side), requests[side][0U]);
+            responses[side] = Json::Value(Json::arrayValue);
+        }
+        Json::FastWriter writer;
+        BotProcess process[2];
+        while (field.GetGameResult() == TankGame::NotFinished)
+        {
+            TurnReply reply[2];
+            for (int side = 0; side < TankGame::sideCount; side++)
+            {
+                if (process[side].Running())
+                {
+                    process[side].Send(writer.write(requests[side][requests[side].size() - 1]));
+                    continue;
+                }
+                // the history is lent to the input and taken back, not copied
+                Json::Value input(Json::objectValue);
+                input["requests"].swap(requests[side]);
+                input["responses"].swap(responses[side]);
+                input["data"] = data[side];
+                input["globaldata"] = globaldata[side];
+                string line = writer.write(input);
+                input["requests"].swap(requests[side]);
+                input["responses"].swap(responses[side]);
+                if (process[side].Start(bots[side]))
+                    process[side].Send(line);
+            }
+            bool failed[2] = {};
+            for (int side = 0; side < TankGame::sideCount; side++)
+            {
+                string output;
+                reply[side].timedOut = !process[side].Read(limitMs, output, reply[side].ms);
+                match.moveMs[side].push_back(reply[side].ms);
+                reply[side].ok = !reply[side].timedOut && ParseReply(output, reply[side]);
+                // like the judge, moves of dead tanks are not checked
+                for (int tank = 0; tank < TankGame::tankPerSide && reply[side].ok; tank++)
+                    reply[side].ok = !field.tankAlive[side][tank] ||
+                        field.ActionIsValid(side, tank, reply[side].action[tank]);
+                if (reply[side].timedOut)
+                    match.timeouts[side]++;
+                else if (!reply[side].ok)
+                    match.invalid[side]++;
+                failed[side] = !reply[side].ok;
+            }
+            match.turns++;
+            if (failed[0] || failed[1])
+            {
+                match.result = failed[0] && failed[1] ? TankGame::Draw : failed[0] ? TankGame::Red : TankGame::Blue;
+                int side = failed[0] ? 0 : 1;
+                match.reason = reply[side].timedOut ? "timeout" : "invalid";
+                return match;
+            }
+            for (int side = 0; side < TankGame::sideCount; side++)
+            {
+                Json::Value move(Json::arrayValue);
+                for (int tank = 0; tank < TankGame::tankPerSide; tank++)
+                {
+                    field.nextAction[side][tank] = reply[side].action[tank];
+                    move.append((int)reply[side].action[tank]);
+                }
+                responses[side].append(move);
+                requests[1 - side].append(move);
+                data[side] = reply[side].data;
+                globaldata[side] = reply[side].globaldata;
+            }
+            field.DoAction();
+        }
+        match.result = field.GetGameResult();
+        match.reason = "finished";
+        return match;
+    }
+
+    // Runs up to games games on threads worker threads; play(game) is called once
+    // per game index, and done(game) under a lock after each one. Once done
+    // returns false no new games start; the ones in flight still finish.
+    template <typename Play, typename Done>
+    void RunGames(int games, int threads, Play play, Done done)
+    {
+        std::atomic<int> next(0);
+        std::atomic<bool> stop(false);
+        std::mutex lock;
+        vector<std::thread> workers;
+        for (int w = 0; w < threads; w++)
+            workers.emplace_back([&]()
+            {
+                for (int game; !stop && (game = next++) < games;)
+                {
+                    play(game);
+                    std::lock_guard<std::mutex> guard(lock);
+                    if (!done(game))
+                        stop = true;
+                }
+            });
+        for (auto &w : workers)
+            w.join();
+    }
+
+    // mean, p99 and max of the move times in milliseconds
+    inline Json::Value TimeSummary(vector<double> ms)
+    {
+        Json::Value summary(Json::objectValue);
+        if (ms.empty())
+            return summary;
+        std::sort(ms.begin(), ms.end());
+        double sum = 0;
+        for (double m : ms)
+            sum += m;
+        summary["moves"] = (int)ms.size();
+        summary["mean_ms"] = sum / ms.size();
+        summary["p99_ms"] = ms[std::min(ms.size() - 1, ms.size() * 99 / 100)];
+        summary["max_ms"] = ms.back();
+        return summary;
+    }
+}
+
+#endif
@@ -0,0 +1,292 @@
+// Self-play data generator for training the policy/value network.
+//
+// Forks --workers processes. Every worker plays MCTSAgent self-play games on
+// random maps: one search per turn, and both sides move from that tree's root
+// statistics. During the first --explore turns moves are sampled from the
+// visit distribution; after that the most visited move is played. Each finished
+// game is appended to the worker's shard with a single write(), so a killed
+// run leaves only whole games behind. Once the workers exit every shard is
+// read back: a bad header, a partial record or a result outside 0..2 fails
+// the run.
+//
+// A shard is a 16-byte ShardHeader followed by fixed-size Records, one per
+// position, so the files can be memory-mapped directly by the trainer.
+//
+//   selfplay [--games 1000] [--workers N] [--iters 2000] [--ms 0] [--explore 8]
+//            [--out selfplay] [--seed 1]
+#include "common.h"
+
+#include <cstdint>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#pragma pack(push, 1)
+struct ShardHeader
+{
+    char magic[4];          // "T2SP"
+    uint32_t version;
+    uint32_t recordSize;
+    uint32_t reserved;
+};
+
+// One position. Masks use the request layout: 27 bits (3 rows) per int.
+// Joint actions of a side are indexed (action0 + 1) * 9 + (action1 + 1).
+struct Record
+{
+    uint32_t brick[3], steel[3], water[3];
+    uint8_t tank[2][2];     // y * 9 + x, 0xFF when dead
+    uint8_t flags;          // bits 0-1: base alive per side, bits 2-5: tank may shoot
+    uint8_t turn;
+    uint8_t result;         // final TankGame::GameResult: 0 blue, 1 red, 2 draw
+    int8_t played[2][2];    // actions actually taken in this position
+    uint8_t reserved;
+    uint16_t visits[2][81]; // root visit distribution per side, sums to ~65535
+};
+#pragma pack(pop)
+
+// version 1 shards stored draws as 255 (TankGame::Draw cast to uint8_t)
+static const uint32_t shardVersion = 2;
+
+// Record::result for a finished game
+static uint8_t ResultCode(TankGame::GameResult result)
+{
+    switch (result)
+    {
+    case TankGame::Blue: return 0;
+    case TankGame::Red: return 1;
+    case TankGame::Draw: return 2;
+    default: throw std::runtime_error("selfplay: game has no result");
+    }
+}
+
+static void EncodePosition(const TankGame::TankField &field, Record &record)
+{
+    memset(&record, 0, sizeof(record));
+    for (int y = 0; y < TankGame::fieldHeight; y++)
+        for (int x = 0; x < TankGame::fieldWidth; x++)
+        {
+            int i = y / 3, bit = 1 << ((y % 3) * TankGame::fieldWidth + x);
+            if (field.gameField[y][x] & TankGame::Brick)
+                record.brick[i] |= bit;
+            if (field.terrain->steelMask[i] & bit)
+                record.steel[i] |= bit;
+            if (field.terrain->waterMask[i] & bit)
+                record.water[i] |= bit;
+        }
+    for (int side = 0; side < TankGame::sideCount; side++)
+    {
+        if (field.baseAlive[side])
+            record.flags |= 1 << side;
+        for (int tank = 0; tank < TankGame::tankPerSide; tank++)
+        {
+            record.tank[side][tank] = field.tankAlive[side][tank]
+                ? field.tankY[side][tank] * TankGame::fieldWidth + field.tankX[side][tank] : 0xFF;
+            if (field.previousActions[field.currentTurn - 1][side][tank] <= TankGame::Left)
+                record.flags |= 1 << (2 + side * TankGame::tankPerSide + tank);
+        }
+    }
+    record.turn = field.currentTurn;
+}
+
+// picks a root move of one side and stores the side's visit distribution
+static Action PickMove(const MCTSAgent::RootStats &stats, int side, bool explore,
+    std::mt19937 &rng, uint16_t visits[81])
+{
+    const vector<double> &count = stats.visits[side];
+    double total = 0;
+    size_t best = 0;
+    for (size_t i = 0; i < count.size(); i++)
+    {
+        total += count[i];
+        if (count[i] > count[best])
+            best = i;
+    }
+    for (size_t i = 0; i < count.size() && total > 0; i++)
+    {
+        Action move = stats.moves[side][i];
+        visits[(move[0] + 1) * 9 + move[1] + 1] = (uint16_t)(count[i] / total * 65535 + 0.5);
+    }
+    if (explore && total > 0)
+    {
+        double r = std::uniform_real_distribution<double>(0, total)(rng);
+        for (size_t i = 0; i < count.size(); i++)
+            if ((r -= count[i]) < 0)
+                return stats.moves[side][i];
+    }
+    return stats.moves[side][best];
+}
+
+static void PlayGame(std::mt19937 &rng, MCTSAgent &agent, int explore, vector<Record> &out)
+{
+    TankGame::TankField field = Tools::RandomMap(rng).Field(0);
+    size_t first = out.size();
+    while (field.GetGameResult() == TankGame::NotFinished)
+    {
+        out.emplace_back();
+        Record &record = out.back();
+        EncodePosition(field, record);
+
+        agent.startClock = clock();
+        MCTSAgent::RootStats stats = agent.search(&field);
+        bool exploring = field.currentTurn <= explore;
+        for (int side = 0; side < TankGame::sideCount; side++)
+        {
+            Action move = PickMove(stats, side, exploring, rng, record.visits[side]);
+            for (int tank = 0; tank < TankGame::tankPerSide; tank++)
+            {
+                field.nextAction[side][tank] = move[tank];
+                record.played[side][tank] = move[tank];
+            }
+        }
+        if (!field.DoAction())
+            throw std::runtime_error("selfplay: search produced an invalid action");
+    }
+    uint8_t result = ResultCode(field.GetGameResult());
+    for (size_t i = first; i < out.size(); i++)
+        out[i].result = result;
+}
+
+static bool WriteAll(int fd, const void *data, size_t size)
+{
+    const char *p = (const char *)data;
+    while (size > 0)
+    {
+        ssize_t n = write(fd, p, size);
+        if (n < 0)
+            return false;
+        p += n;
+        size -= n;
+    }
+    return true;
+}
+
+static int Worker(int worker, int workers, int games, const Tools::Options &options, const string &path)
+{
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0)
+    {
+        std::cerr << "selfplay: cannot open " << path << endl;
+        return 1;
+    }
+    ShardHeader header = { { 'T', '2', 'S', 'P' }, shardVersion, sizeof(Record), 0 };
+    if (st.st_size == 0)
+    {
+        if (!WriteAll(fd, &header, sizeof(header)))
+            return 1;
+    }
+    else
+    {
+        // appending is only safe to a shard of the same layout
+        ShardHeader existing;
+        if (pread(fd, &existing, sizeof(existing), 0) != sizeof(existing) ||
+            memcmp(&existing, &header, sizeof(header)))
+        {
+            std::cerr << "selfplay: " << path << " is not a version " << shardVersion << " shard" << endl;
+            return 1;
+        }
+    }
+
+    unsigned seed = options.GetInt("seed", 1);
+    srand(seed * 7919u + worker);
+    MCTSAgent agent(0.05, 81, 81, 5);
+    agent.maxIterations = options.GetInt("iters", 2000);
+    int ms = options.GetInt("ms", 0);
+    agent.timeLimit = ms > 0 ? ms / 1000.0 : std::numeric_limits<double>::infinity();
+    int explore = options.GetInt("explore", 8);
+
+    vector<Record> records;
+    for (int g = worker; g < games; g += workers)
+    {
+        std::mt19937 rng(seed * 1000003u + g);
+        records.clear();
+        PlayGame(rng, agent, explore, records);
+        if (!WriteAll(fd, records.data(), records.size() * sizeof(Record)))
+        {
+            std::cerr << "selfplay: write to " << path << " failed" << endl;
+            return 1;
+        }
+    }
+    close(fd);
+    return 0;
+}
+
+// reads a finished shard back; false (with a message) when it is malformed
+static bool CheckShard(const string &path, long long &records)
+{
+    std::ifstream in(path, std::ios::binary);
+    ShardHeader header;
+    ShardHeader expected = { { 'T', '2', 'S', 'P' }, shardVersion, sizeof(Record), 0 };
+    if (!in.read((char *)&header, sizeof(header)) || memcmp(&header, &expected, sizeof(header)))
+    {
+        std::cerr << "selfplay: " << path << ": bad header" << endl;
+        return false;
+    }
+    Record record;
+    records = 0;
+    while (in.read((char *)&record, sizeof(record)))
+    {
+        if (record.result > 2)
+        {
+            std::cerr << "selfplay: " << path << ": record " << records << " has result "
+                << (int)record.result << endl;
+            return false;
+        }
+        records++;
+    }
+    if (in.gcount() != 0)
+    {
+        std::cerr << "selfplay: " << path << ": truncated record at the end" << endl;
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    Tools::Options options(argc, argv);
+    int games = options.GetInt("games", 1000);
+    int workers = options.GetInt("workers", Tools::DefaultThreads());
+    string dir = options.GetString("out", "selfplay");
+    mkdir(dir.c_str(), 0755);
+
+    auto start = std::chrono::steady_clock::now();
+    vector<pid_t> children;
+    for (int w = 0; w < workers; w++)
+    {
+        string path = dir + "/shard-" + std::to_string(w) + ".bin";
+        pid_t pid = fork();
+        if (pid == 0)
+            _exit(Worker(w, workers, games, options, path));
+        if (pid < 0)
+        {
+            std::cerr << "selfplay: fork failed" << endl;
+            return 1;
+        }
+        children.push_back(pid);
+    }
+    int failed = 0;
+    for (pid_t pid : children)
+    {
+        int status;
+        waitpid(pid, &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+            failed++;
+    }
+    long long total = 0;
+    for (int w = 0; w < workers; w++)
+    {
+        long long records;
+        if (CheckShard(dir + "/shard-" + std::to_string(w) + ".bin", records))
+            total += records;
+        else
+            failed++;
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cerr << games << " games by " << workers << " workers in " << seconds << "s, "
+        << games / seconds * 3600 << " games/hour, " << total << " records checked" << endl;
+    return failed ? 1 : 0;
+}
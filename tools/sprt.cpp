@@ -0,0 +1,155 @@
+// SPRT gate: plays bot0 against bot1 with the local referee until a sequential
+// probability ratio test accepts H0 (bot0 is elo0 stronger) or H1 (elo1
+// stronger), or --max-games runs out.
+//
+// Games come in pairs on one map with the sides swapped, and the test runs on
+// the pair scores (pentanomial GSPRT, the normal approximation used by
+// Fishtest), which removes most of the map and side noise. bot0/bot1 are shell
+// commands, so two builds or two settings of one build can be compared:
+//
+//   sprt --bot0 "./bot --time 0.45" --bot1 "./bot --time 0.45 --s 0.1"
+//        [--elo0 0] [--elo1 5] [--alpha 0.05] [--beta 0.05] [--max-games 20000]
+//        [--min-games 40] [--threads N] [--time-ms 1000] [--seed 1]
+//
+// The variance is estimated from the pairs themselves, so no verdict is given
+// before --min-games; a handful of pairs can look deceptively decisive.
+//
+// Bots must be built with -D_BOTZONE_ONLINE. The verdict, Elo with a 95% error
+// bar and the counts go to stdout as JSON.
+#include "referee.h"
+
+static double EloToScore(double elo)
+{
+    return 1 / (1 + pow(10, -elo / 400));
+}
+
+static double ScoreToElo(double score)
+{
+    score = std::min(std::max(score, 1e-6), 1 - 1e-6);
+    return -400 * log10(1 / score - 1);
+}
+
+struct PairStats
+{
+    long long count[5] = {}; // pairs scoring 0, 0.5, 1, 1.5, 2 for bot0
+
+    long long pairs() const
+    {
+        long long n = 0;
+        for (long long c : count)
+            n += c;
+        return n;
+    }
+    // mean and variance of the per-game score of a pair
+    void moments(double &mean, double &variance) const
+    {
+        long long n = pairs();
+        mean = variance = 0;
+        for (int i = 0; i < 5; i++)
+            mean += count[i] * (i / 4.0);
+        mean /= n;
+        for (int i = 0; i < 5; i++)
+            variance += count[i] * (i / 4.0 - mean) * (i / 4.0 - mean);
+        variance /= n;
+    }
+    double llr(double elo0, double elo1) const
+    {
+        double mean, variance;
+        moments(mean, variance);
+        if (variance <= 0)
+            return 0;
+        double s0 = EloToScore(elo0), s1 = EloToScore(elo1);
+        return pairs() * (s1 - s0) * (2 * mean - s0 - s1) / (2 * variance);
+    }
+};
+
+int main(int argc, char **argv)
+{
+    Tools::Options options(argc, argv);
+    string bots[2] = { options.GetString("bot0", ""), options.GetString("bot1", "") };
+    if (bots[0].empty() || bots[1].empty())
+    {
+        std::cerr << "usage: sprt --bot0 <command> --bot1 <command> [--elo0 0] [--elo1 5] [--alpha 0.05]"
+            " [--beta 0.05] [--max-games 20000] [--min-games 40] [--threads N] [--time-ms 1000] [--seed 1]" << endl;
+        return 1;
+    }
+    double elo0 = options.GetDouble("elo0", 0), elo1 = options.GetDouble("elo1", 5);
+    double alpha = options.GetDouble("alpha", 0.05), beta = options.GetDouble("beta", 0.05);
+    int maxGames = options.GetInt("max-games", 20000) & ~1;
+    long long minPairs = options.GetInt("min-games", 40) / 2;
+    int threads = options.GetInt("threads", std::max(1, Tools::DefaultThreads() / 2));
+    double limitMs = options.GetDouble("time-ms", 1000);
+    unsigned seed = options.GetInt("seed", 1);
+    double lower = log(beta / (1 - alpha)), upper = log((1 - beta) / alpha);
+
+    vector<Tools::MatchResult> results(maxGames);
+    vector<char> finished(maxGames);
+    PairStats stats;
+    int timeouts[2] = {}, invalid[2] = {};
+    double llr = 0;
+    string verdict = "inconclusive";
+    auto start = std::chrono::steady_clock::now();
+    Tools::RunGames(maxGames, threads, [&](int game)
+    {
+        std::mt19937 rng(seed * 1000003u + game / 2);
+        Tools::MapSpec map = Tools::RandomMap(rng);
+        string order[2] = { bots[game & 1], bots[~game & 1] };
+        results[game] = Tools::PlayMatch(order, map, limitMs);
+    }, [&](int game)
+    {
+        finished[game] = 1;
+        for (int side = 0; side < TankGame::sideCount; side++)
+        {
+            timeouts[side ^ (game & 1)] += results[game].timeouts[side];
+            invalid[side ^ (game & 1)] += results[game].invalid[side];
+        }
+        if (!finished[game ^ 1] || verdict != "inconclusive")
+            return verdict == "inconclusive";
+        int first = game & ~1;
+        double score = Tools::ResultFor(results[first].result, 0) + Tools::ResultFor(results[first + 1].result, 1);
+        stats.count[(int)(score * 2 + 0.5)]++;
+        llr = stats.llr(elo0, elo1);
+        if (stats.pairs() >= minPairs && llr >= upper)
+            verdict = "H1";
+        else if (stats.pairs() >= minPairs && llr <= lower)
+            verdict = "H0";
+        std::cerr << "\rpairs " << stats.pairs() << "  llr " << llr << " [" << lower << ", " << upper << "]   ";
+        return verdict == "inconclusive";
+    });
+    std::cerr << endl;
+
+    long long pairs = stats.pairs();
+    double mean = 0.5, variance = 0;
+    if (pairs > 0)
+        stats.moments(mean, variance);
+    double margin = 1.96 * sqrt(variance / std::max(1LL, pairs));
+    Json::Value report(Json::objectValue);
+    report["verdict"] = verdict;
+    report["llr"] = llr;
+    report["lower_bound"] = lower;
+    report["upper_bound"] = upper;
+    report["elo0"] = elo0;
+    report["elo1"] = elo1;
+    report["pairs"] = (Json::Int64)pairs;
+    report["games"] = (Json::Int64)pairs * 2;
+    Json::Value pentanomial(Json::arrayValue);
+    for (long long c : stats.count)
+        pentanomial.append((Json::Int64)c);
+    report["pentanomial"] = pentanomial;
+    report["score"] = mean;
+    report["elo"] = ScoreToElo(mean);
+    report["elo_low95"] = ScoreToElo(mean - margin);
+    report["elo_high95"] = ScoreToElo(mean + margin);
+    report["seconds"] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    for (int bot = 0; bot < 2; bot++)
+    {
+        Json::Value &entry = report[bot ? "bot1" : "bot0"];
+        entry["command"] = bots[bot];
+        entry["timeouts"] = timeouts[bot];
+        entry["invalid"] = invalid[bot];
+    }
+    std::cerr << verdict << ": elo " << ScoreToElo(mean) << " [" << ScoreToElo(mean - margin) << ", "
+        << ScoreToElo(mean + margin) << "] after " << pairs * 2 << " games" << endl;
+    cout << Json::StyledWriter().write(report);
+    return 0;
+}
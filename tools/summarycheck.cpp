@@ -0,0 +1,214 @@
+// Round-trip check for the MCTSAgent warm start through the data field.
+//
+// For every corpus position (FastAgent self-play on seeded random maps, both
+// sides to move) one agent searches --iters simulations and writes
+// saveSummary for its move. Then, for each opponent reply the summary holds,
+// a fresh agent loads it and starts a search of no simulations on the
+// position after that reply, so its root is exactly what the graft made, as
+// in the next turn's process. The grafted tree must match the
+// saved one: visits and wins of every kept node and root move equal to the
+// searched tree's (rounded to float) times summaryWeight, no counts on moves
+// the summary dropped, and as many children as writeNode keeps. An agent
+// whose summaryDepth is one lower must refuse a summary that holds deeper
+// nodes. Every summary is also loaded with its last byte cut off; build with
+// -fsanitize=address to check that nothing reads past the end. Exits with 1
+// on any failure; a summary goes to stdout as JSON.
+//
+//   summarycheck [--positions 32] [--iters 5000] [--seed 1]
+#include "common.h"
+
+typedef MCTSAgent::MCTnode Node;
+
+static vector<TankGame::TankField> Corpus(int count, unsigned seed)
+{
+    vector<TankGame::TankField> corpus;
+    corpus.reserve(count);
+    FastAgent agent(8);
+    srand(seed);
+    for (int game = 0; (int)corpus.size() < count; game++)
+    {
+        std::mt19937 rng(seed * 1000003u + game);
+        TankGame::TankField field = Tools::RandomMap(rng).Field(0);
+        while (field.GetGameResult() == TankGame::NotFinished && (int)corpus.size() < count)
+        {
+            if (rng() % 4 == 0)
+            {
+                corpus.emplace_back(field);
+                corpus.back().logs = std::stack<TankGame::DisappearLog>();
+            }
+            Action blue = agent.getAction(&field);
+            field.mySide = 1;
+            Action red = agent.getAction(&field);
+            field.mySide = 0;
+            for (int tank = 0; tank < TankGame::tankPerSide; tank++)
+            {
+                field.nextAction[0][tank] = blue[tank];
+                field.nextAction[1][tank] = red[tank];
+            }
+            field.DoAction();
+        }
+    }
+    return corpus;
+}
+
+static MCTSAgent *NewAgent(int iters)
+{
+    MCTSAgent *agent = new MCTSAgent(0.05, 81, 81, 5);
+    agent->maxIterations = iters;
+    agent->timeLimit = std::numeric_limits<double>::infinity();
+    return agent;
+}
+
+// what readNode stores for a count written by writeNode
+static double Grafted(const MCTSAgent &agent, double saved)
+{
+    return (double)(float)saved * agent.summaryWeight;
+}
+
+struct CheckResult
+{
+    int grafts = 0, nodes = 0, failures = 0;
+};
+
+// compares the grafted node with the searched one it was saved from
+static bool SameNode(const MCTSAgent &agent, const Node *saved, const Node *grafted, int depth, CheckResult &result)
+{
+    result.nodes++;
+    if (grafted->visitCount != Grafted(agent, saved->visitCount) ||
+        grafted->winCount != Grafted(agent, saved->winCount))
+        return false;
+    if (saved->result != -1)
+        return grafted->nxt.empty();
+    vector<int> kept[2];
+    for (int side = 0; side < 2; ++side)
+    {
+        const MCTSAgent::ActionAgent &from = saved->actionAgent[side], &to = grafted->actionAgent[side];
+        kept[side] = MCTSAgent::topIndices(from.visitSum, agent.summaryMoves);
+        int counted = 0;
+        for (int i : kept[side])
+        {
+            int j = MCTSAgent::findMove(to, from.validMove[i].a[0], from.validMove[i].a[1]);
+            if (j < 0 || to.visitSum[j] != Grafted(agent, from.visitSum[i]) ||
+                to.winSum[j] != Grafted(agent, from.winSum[i]))
+                return false;
+        }
+        for (int j = 0; j < to.actionNum; ++j)
+            counted += to.visitSum[j] != 0;
+        if (counted != (int)kept[side].size())
+            return false;
+    }
+    // writeNode keeps the summaryChildren most visited children between kept moves
+    int eligible = 0;
+    for (int i : kept[0])
+        for (int j : kept[1])
+        {
+            auto it = saved->nxt.find(i * saved->actionAgent[1].actionNum + j);
+            eligible += it != saved->nxt.end() && it->second->visitCount >= agent.summaryMinVisits;
+        }
+    if ((int)grafted->nxt.size() != (depth > 0 ? std::min(eligible, agent.summaryChildren) : 0))
+        return false;
+    for (auto &child : grafted->nxt)
+    {
+        const MCTSAgent::ActionAgent &to0 = grafted->actionAgent[0], &to1 = grafted->actionAgent[1];
+        const Action &move0 = to0.validMove[child.first / to1.actionNum], &move1 = to1.validMove[child.first % to1.actionNum];
+        int i = MCTSAgent::findMove(saved->actionAgent[0], move0.a[0], move0.a[1]);
+        int j = MCTSAgent::findMove(saved->actionAgent[1], move1.a[0], move1.a[1]);
+        auto it = saved->nxt.find(i * saved->actionAgent[1].actionNum + j);
+        if (i < 0 || j < 0 || it == saved->nxt.end() || !SameNode(agent, it->second, child.second, depth - 1, result))
+            return false;
+    }
+    return true;
+}
+
+// loads data into a fresh agent and builds the root for field without searching
+static MCTSAgent *Graft(const string &data, TankGame::TankField &field, int depth)
+{
+    MCTSAgent *agent = NewAgent(0);
+    agent->summaryDepth = depth;
+    agent->loadSummary(data);
+    agent->search(&field);
+    return agent;
+}
+
+static void CheckPosition(TankGame::TankField &field, int iters, CheckResult &result)
+{
+    std::unique_ptr<MCTSAgent> saver(NewAgent(iters));
+    Action played = chooseAction(saver->getActions(&field));
+    string data = saver->saveSummary(played);
+    vector<unsigned char> blob;
+    if (!Base64Decode(data.c_str(), blob) || blob.size() < MCTSAgent::summaryHeader)
+    {
+        result.failures++;
+        return;
+    }
+    int entries = blob[MCTSAgent::summaryHeader - 1];
+
+    // the replies saveSummary wrote, in its order
+    const Node *root = saver->searchRoot();
+    int side = field.mySide;
+    int mine = MCTSAgent::findMove(root->actionAgent[side], played[0], played[1]);
+    const MCTSAgent::ActionAgent &enemy = root->actionAgent[1 - side];
+    for (int reply : MCTSAgent::topIndices(enemy.visitSum, saver->summaryReplies))
+    {
+        if (entries == 0)
+            break;
+        int hashID = side == 0 ? mine * enemy.actionNum + reply : reply * root->actionAgent[1].actionNum + mine;
+        auto it = root->nxt.find(hashID);
+        if (it == root->nxt.end())
+            continue;
+        --entries;
+        const Node *saved = it->second;
+        if (saved->result != -1)
+            continue;
+        TankGame::TankField next = saved->Field;
+
+        int depth = saver->summaryDepth;
+        std::unique_ptr<MCTSAgent> loader(Graft(data, next, depth));
+        const Node *grafted = loader->searchRoot();
+        bool ok = SameNode(*loader, saved, grafted, depth, result);
+
+        // a summary with nodes below the loader's depth is refused, not followed
+        std::unique_ptr<MCTSAgent> shallow(Graft(data, next, depth - 1));
+        const Node *refused = shallow->searchRoot();
+        ok = ok && (grafted->nxt.empty() || (refused->visitCount == 0 && refused->nxt.empty()));
+
+        // nothing may be read past the end of a truncated summary
+        std::unique_ptr<MCTSAgent> cut(Graft(Base64Encode(blob.data(), blob.size() - 1), next, depth));
+
+        result.grafts++;
+        if (!ok)
+            result.failures++;
+    }
+    if (entries != 0)
+        result.failures++;
+}
+
+int main(int argc, char **argv)
+{
+    Tools::Options options(argc, argv);
+    int count = options.GetInt("positions", 32);
+    int iters = options.GetInt("iters", 5000);
+    unsigned seed = options.GetInt("seed", 1);
+
+    vector<TankGame::TankField> corpus = Corpus(count, seed);
+    CheckResult result;
+    for (TankGame::TankField &field : corpus)
+        for (int side = 0; side < TankGame::sideCount; side++)
+        {
+            field.mySide = side;
+            CheckPosition(field, iters, result);
+        }
+
+    bool ok = result.failures == 0 && result.grafts > 0;
+    std::cerr << result.grafts << " grafts, " << result.nodes << " nodes compared, "
+        << result.failures << " failures" << endl;
+    Json::Value report(Json::objectValue);
+    report["positions"] = (int)corpus.size();
+    report["iterations"] = iters;
+    report["grafts"] = result.grafts;
+    report["nodes"] = result.nodes;
+    report["failures"] = result.failures;
+    report["ok"] = ok;
+    cout << Json::StyledWriter().write(report);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,170 @@
+// Offline tuner for the Judger::getScore weights (JudgerParams).
+//
+// Plays a batch of FastAgent self-play games on random maps in parallel, keeps
+// sampled positions with the final result, then fits the weights Texel-style:
+// coordinate-wise local search minimising the squared error between getScore
+// and the game result. The fitted block goes to stdout, ready to be pasted
+// into judgerParamBlock.
+//
+//   tuner [--games 4000] [--threads N] [--ft 8] [--sample 0.2] [--passes 30]
+//         [--seed 1] [--init "secondTank=0.8 ..."]
+#include "common.h"
+
+struct Sample
+{
+    TankGame::TankField field;
+    double result;
+};
+
+// one self-play game; every position is kept with probability sampleRate
+static void PlayGame(std::mt19937 &rng, FastAgent &agent, double sampleRate, vector<Sample> &out)
+{
+    TankGame::TankField field = Tools::RandomMap(rng).Field(0);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    size_t first = out.size();
+    while (field.GetGameResult() == TankGame::NotFinished)
+    {
+        if (uniform(rng) < sampleRate)
+        {
+            out.push_back(Sample{ field, 0 });
+            out.back().field.logs = std::stack<TankGame::DisappearLog>();
+            out.back().field.mySide = rng() & 1;
+        }
+        Action blue = agent.getAction(&field);
+        field.mySide = 1;
+        Action red = agent.getAction(&field);
+        field.mySide = 0;
+        for (int tank = 0; tank < TankGame::tankPerSide; tank++)
+        {
+            field.nextAction[0][tank] = blue[tank];
+            field.nextAction[1][tank] = red[tank];
+        }
+        if (!field.DoAction())
+            throw std::runtime_error("tuner: self-play produced an invalid action");
+    }
+    TankGame::GameResult result = field.GetGameResult();
+    for (size_t i = first; i < out.size(); i++)
+        out[i].result = Tools::ResultFor(result, out[i].field.mySide);
+}
+
+static vector<Sample> SelfPlay(int games, int threads, int ft, double sampleRate, unsigned seed)
+{
+    vector<vector<Sample> > parts(threads);
+    vector<std::thread> workers;
+    for (int w = 0; w < threads; w++)
+        workers.emplace_back([&, w]()
+        {
+            std::unique_ptr<Judger> judger(new Judger);
+            FastAgent agent(ft, judger.get());
+            for (int g = w; g < games; g += threads)
+            {
+                std::mt19937 rng(seed * 1000003u + g);
+                PlayGame(rng, agent, sampleRate, parts[w]);
+            }
+        });
+    for (auto &w : workers)
+        w.join();
+    vector<Sample> samples;
+    for (auto &part : parts)
+        samples.insert(samples.end(), part.begin(), part.end());
+    return samples;
+}
+
+// mean squared error of getScore against the results, spread over the judgers
+static double Loss(const vector<Sample> &samples, size_t begin, size_t end,
+    const JudgerParams &params, vector<std::unique_ptr<Judger> > &judgers)
+{
+    int threads = judgers.size();
+    vector<double> sums(threads);
+    vector<std::thread> workers;
+    for (int w = 0; w < threads; w++)
+        workers.emplace_back([&, w]()
+        {
+            Judger &judger = *judgers[w];
+            judger.setParams(params);
+            double sum = 0;
+            for (size_t i = begin + w; i < end; i += threads)
+            {
+                TankGame::TankField field = samples[i].field;
+                double error = judger.getScore(&field) - samples[i].result;
+                sum += error * error;
+            }
+            sums[w] = sum;
+        });
+    for (auto &w : workers)
+        w.join();
+    double sum = 0;
+    for (double s : sums)
+        sum += s;
+    return end > begin ? sum / (end - begin) : 0;
+}
+
+int main(int argc, char **argv)
+{
+    Tools::Options options(argc, argv);
+    int games = options.GetInt("games", 4000);
+    int threads = options.GetInt("threads", Tools::DefaultThreads());
+    int ft = options.GetInt("ft", 8);
+    int passes = options.GetInt("passes", 30);
+    double sampleRate = options.GetDouble("sample", 0.2);
+    unsigned seed = options.GetInt("seed", 1);
+    srand(seed);
+
+    JudgerParams params;
+    if (!params.load(options.GetString("init", judgerParamBlock)))
+    {
+        std::cerr << "tuner: bad --init parameter block" << endl;
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    vector<Sample> samples = SelfPlay(games, threads, ft, sampleRate, seed);
+    std::shuffle(samples.begin(), samples.end(), std::mt19937(seed));
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cerr << games << " games, " << samples.size() << " positions in " << seconds << "s" << endl;
+    if (samples.empty())
+        return 1;
+
+    // the last tenth is held out to see whether the fit generalises
+    size_t trainEnd = samples.size() - samples.size() / 10;
+    vector<std::unique_ptr<Judger> > judgers;
+    for (int w = 0; w < threads; w++)
+    {
+        judgers.emplace_back(new Judger);
+        judgers.back()->evalCache.resize(0);
+    }
+
+    double best = Loss(samples, 0, trainEnd, params, judgers);
+    double heldOut = Loss(samples, trainEnd, samples.size(), params, judgers);
+    std::cerr << "initial loss " << best << " (held out " << heldOut << ")" << endl;
+
+    double step[JudgerParams::count];
+    for (int i = 0; i < JudgerParams::count; i++)
+        step[i] = std::max(0.05, std::fabs(params.value(i)) * 0.25);
+    for (int pass = 0; pass < passes; pass++)
+    {
+        bool improved = false;
+        for (int i = 0; i < JudgerParams::count; i++)
+            for (int sign = 1; sign >= -1; sign -= 2)
+            {
+                JudgerParams trial = params;
+                trial.value(i) += sign * step[i];
+                double loss = Loss(samples, 0, trainEnd, trial, judgers);
+                if (loss < best)
+                {
+                    best = loss;
+                    params = trial;
+                    improved = true;
+                    break;
+                }
+            }
+        if (!improved)
+            for (double &s : step)
+                s /= 2;
+        std::cerr << "pass " << pass << ": loss " << best << "  " << params.dump() << endl;
+    }
+
+    heldOut = Loss(samples, trainEnd, samples.size(), params, judgers);
+    std::cerr << "final loss " << best << " (held out " << heldOut << ")" << endl;
+    cout << params.dump() << endl;
+}